@@ -0,0 +1,135 @@
+/**
+ * @file atlas.cpp
+ * Packing of many small images into the layers of a texture array.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <climits>
+#include "atlas.h"
+
+SkylinePacker::SkylinePacker(int size) : size(size)
+{
+    skyline.push_back(Segment{0, 0, size});
+}
+
+/**
+ * Bottom of a w x h rectangle whose left edge is at segment i: the
+ * highest segment under it, or -1 if it sticks out of the page.
+ */
+int SkylinePacker::fit(size_t i, int w, int h) const
+{
+    int x = skyline[i].x;
+    if (x + w > size) return -1;
+
+    int y = 0;
+    for (size_t j = i; j < skyline.size() && skyline[j].x < x + w; j++)
+        y = std::max(y, skyline[j].y);
+    return y + h <= size ? y : -1;
+}
+
+bool SkylinePacker::insert(int w, int h, int& x, int& y)
+{
+    size_t best = SIZE_MAX;
+    int bestTop = INT_MAX, bestWidth = INT_MAX;
+    for (size_t i = 0; i < skyline.size(); i++) {
+        int bottom = fit(i, w, h);
+        if (bottom < 0) continue;
+        int top = bottom + h;
+        if (top < bestTop || (top == bestTop && skyline[i].width < bestWidth)) {
+            best = i;
+            bestTop = top;
+            bestWidth = skyline[i].width;
+        }
+    }
+    if (best == SIZE_MAX) return false;
+
+    x = skyline[best].x;
+    y = bestTop - h;
+
+    // The new segment covers [x, x + w); cut what it hides off the ones after.
+    skyline.insert(skyline.begin() + best, Segment{x, bestTop, w});
+    for (size_t j = best + 1; j < skyline.size();) {
+        Segment& s = skyline[j];
+        int hidden = x + w - s.x;
+        if (hidden <= 0) break;
+        if (hidden < s.width) {
+            s.x += hidden;
+            s.width -= hidden;
+            break;
+        }
+        skyline.erase(skyline.begin() + j);
+    }
+
+    // Neighbours at the same height become one segment.
+    for (size_t j = 0; j + 1 < skyline.size();) {
+        if (skyline[j].y == skyline[j + 1].y) {
+            skyline[j].width += skyline[j + 1].width;
+            skyline.erase(skyline.begin() + j + 1);
+        } else {
+            j++;
+        }
+    }
+
+    used += (size_t)w * h;
+    return true;
+}
+
+int packAtlas(const std::vector<glm::ivec2>& sizes, int size, int padding, std::vector<AtlasRect>& rects)
+{
+    std::vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return sizes[a].y != sizes[b].y ? sizes[a].y > sizes[b].y : sizes[a].x > sizes[b].x;
+    });
+
+    std::vector<SkylinePacker> layers;
+    rects.resize(sizes.size());
+    for (size_t i : order) {
+        int w = sizes[i].x + 2 * padding, h = sizes[i].y + 2 * padding;
+        if (w > size || h > size) return -1;
+
+        int x, y;
+        size_t l = 0;
+        while (l < layers.size() && !layers[l].insert(w, h, x, y))
+            l++;
+        if (l == layers.size()) {
+            layers.push_back(SkylinePacker(size));
+            layers.back().insert(w, h, x, y);
+        }
+        rects[i] = AtlasRect{(int)l, x + padding, y + padding, sizes[i].x, sizes[i].y};
+    }
+    return (int)layers.size();
+}
+
+void blitToAtlas(uint8_t* layer, int size, int channels, const uint8_t* image, const AtlasRect& rect, int padding)
+{
+    // Every pixel of the padded rectangle takes the nearest image pixel.
+    for (int y = -padding; y < rect.height + padding; y++) {
+        int sy = std::min(std::max(y, 0), rect.height - 1);
+        uint8_t* dst = layer + ((size_t)(rect.y + y) * size + rect.x - padding) * channels;
+        const uint8_t* row = image + (size_t)sy * rect.width * channels;
+
+        for (int x = -padding; x < 0; x++, dst += channels)
+            memcpy(dst, row, channels);
+        memcpy(dst, row, (size_t)rect.width * channels);
+        dst += (size_t)rect.width * channels;
+        for (int x = 0; x < padding; x++, dst += channels)
+            memcpy(dst, row + (size_t)(rect.width - 1) * channels, channels);
+    }
+}
+
+int atlasMaxLevel(int padding)
+{
+    int level = 0;
+    while ((4 << level) <= padding)
+        level++;
+    return level;
+}
+
+glm::vec4 atlasUVTransform(const AtlasRect& rect, int size)
+{
+    return glm::vec4((float)rect.width / size, (float)rect.height / size, (float)rect.x / size,
+                     (float)rect.y / size);
+}
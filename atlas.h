@@ -0,0 +1,96 @@
+/**
+ * @file atlas.h
+ * Packing of many small images into the layers of a texture array.
+ */
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * Skyline bottom-left packer for one square page.
+ *
+ * The free space is kept as the skyline of the rectangles placed so far:
+ * a list of horizontal segments, left to right. A rectangle goes where
+ * its top would be lowest, on the narrowest segment among ties, which
+ * wastes little space for images of similar heights.
+ */
+class SkylinePacker
+{
+public:
+    explicit SkylinePacker(int size);
+
+    /**
+     * Places a w x h rectangle.
+     *
+     * @return False if it does not fit anywhere.
+     */
+    bool insert(int w, int h, int& x, int& y);
+
+    /** Fraction of the page covered by rectangles. */
+    double occupancy() const { return (double)used / ((double)size * size); }
+
+private:
+    struct Segment
+    {
+        int x, y, width;
+    };
+
+    int fit(size_t i, int w, int h) const;
+
+    std::vector<Segment> skyline;
+    int size;
+    size_t used = 0;
+};
+
+/** Where an image went: layer and pixel rectangle, without the gutter. */
+struct AtlasRect
+{
+    int layer;
+    int x, y, width, height;
+};
+
+/**
+ * Packs images into as few size x size layers as it can.
+ *
+ * Images are placed tallest first, each into the first layer it fits in.
+ * Each keeps a gutter of padding pixels on every side, for blitToAtlas to
+ * fill, so bilinear filtering never reads a neighbour.
+ *
+ * @param sizes Width and height of each image.
+ * @param rects Receives one rectangle per image, in input order.
+ * @return Number of layers, or -1 if an image is larger than a layer.
+ */
+int packAtlas(const std::vector<glm::ivec2>& sizes, int size, int padding, std::vector<AtlasRect>& rects);
+
+/**
+ * Copies an image into its rectangle of a layer and extends its edge
+ * pixels over the gutter.
+ *
+ * @param layer size x size pixels of channels bytes each.
+ * @param image rect.width x rect.height pixels, rows tightly packed.
+ */
+void blitToAtlas(uint8_t* layer, int size, int channels, const uint8_t* image, const AtlasRect& rect, int padding);
+
+/**
+ * Last mip level at which bilinear filtering inside an image still reads
+ * only the image and its gutter, wherever the packer placed it.
+ *
+ * At level L a texel covers 2^L pixels starting on a multiple of 2^L, so
+ * a sample at an image edge reads up to 2^(L + 1) - 1 pixels past it: the
+ * rest of the texel holding the edge and the whole next one. The level is
+ * the largest L with 2^(L + 1) <= padding (0 for padding below 4).
+ */
+int atlasMaxLevel(int padding);
+
+/**
+ * Scale (xy) and offset (zw) that map the image's [0, 1] UVs into the
+ * layer: uv * scale + offset. UVs outside [0, 1] no longer repeat.
+ */
+glm::vec4 atlasUVTransform(const AtlasRect& rect, int size);
+
+#endif
@@ -0,0 +1,565 @@
+/**
+ * @file bench_clip.cpp
+ * Benchmarks for the polygon clippers in clip.cpp.
+ *
+ * Usage: bench_clip [polygons] [max vertices] [rounds]
+ *        bench_clip tiles [max threads]
+ *        bench_clip window
+ *        bench_clip triangulate
+ *        bench_clip precision
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+#include "clip.h"
+#include "precise_clip.h"
+#include "thread_pool.h"
+#include "tile_clip.h"
+#include "triangulate.h"
+#include "window_clip.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/** Heap allocations since start, counted by the operator new below. */
+static unsigned long allocations = 0;
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static double secondsSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+/** Random star-shaped (possibly concave) polygons around the clip window. */
+static std::vector<std::vector<glm::vec2>> randomPolygons(int count, int maxVertices, unsigned seed,
+                                                          float maxRadius = 0.8f)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> center(-1.5f, 1.5f);
+    std::uniform_real_distribution<float> radius(maxRadius / 16, maxRadius);
+    std::uniform_real_distribution<float> jitter(0.5f, 1.0f);
+    std::uniform_int_distribution<int> vertices(3, maxVertices);
+
+    std::vector<std::vector<glm::vec2>> polygons(count);
+    for (std::vector<glm::vec2>& poly : polygons) {
+        glm::vec2 c(center(rng), center(rng));
+        float r = radius(rng);
+        int n = vertices(rng);
+        for (int i = 0; i < n; i++) {
+            float a = 6.2831853f * i / n;
+            poly.push_back(c + glm::vec2(std::cos(a), std::sin(a)) * (r * jitter(rng)));
+        }
+    }
+    return polygons;
+}
+
+static void report(const char* name, size_t polygons, int rounds, double s, unsigned long allocs, size_t vertices)
+{
+    double ops = (double)polygons * rounds;
+    printf("%-14s %12.0f polygons/s %8.3f allocs/op  (%zu vertices out)\n", name, ops / s, allocs / ops, vertices);
+}
+
+/** Tile clipping for 1..maxThreads threads and growing grids. */
+static void benchTiles(unsigned maxThreads)
+{
+    const int grids[] = {1, 4, 16, 64};
+    const int count = 100000;
+
+    PolygonSoA polygons;
+    for (const std::vector<glm::vec2>& poly : randomPolygons(count, 16, 42, 0.1f))
+        polygons.add(poly.data(), poly.size());
+
+    printf("%d polygons, tile clipping, polygons/s (speedup)\n", count);
+    printf("%8s", "threads");
+    for (int g : grids)
+        printf(" %10dx%-3d      ", g, g);
+    printf("\n");
+
+    std::vector<double> base;
+    TileClipResult result;
+    for (unsigned t = 1; t <= maxThreads; t++) {
+        ThreadPool pool(t);
+        printf("%8u", t);
+        for (size_t k = 0; k < sizeof(grids) / sizeof(grids[0]); k++) {
+            TileGrid grid{glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f), grids[k], grids[k]};
+            int rounds = 5;
+
+            clipPolygonsToTiles(polygons, grid, result, pool);
+            Clock::time_point t0 = Clock::now();
+            for (int r = 0; r < rounds; r++)
+                clipPolygonsToTiles(polygons, grid, result, pool);
+            double s = secondsSince(t0) / rounds;
+
+            if (t == 1) base.push_back(s);
+            printf(" %12.0f (%4.1fx)", count / s, base[k] / s);
+        }
+        printf("\n");
+    }
+
+    // How much the bounding box binning saves over clipping every pair.
+    printf("%8s", "pairs");
+    for (int g : grids) {
+        ThreadPool pool(1);
+        TileGrid grid{glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f), g, g};
+        clipPolygonsToTiles(polygons, grid, result, pool);
+        printf(" %8zu/%-10.0f", result.binPolygons.size(), (double)count * g * g);
+    }
+    printf("\n");
+}
+
+/** Star-shaped window of m vertices, concave unless convex is set. */
+static std::vector<glm::vec2> starWindow(int m, bool convex)
+{
+    std::vector<glm::vec2> window;
+    for (int i = 0; i < m; i++) {
+        float a = 6.2831853f * i / m;
+        float r = convex || i % 2 == 0 ? 1.0f : 0.6f;
+        window.push_back(glm::vec2(std::cos(a), std::sin(a)) * r);
+    }
+    return window;
+}
+
+/**
+ * A pentagram turns the same way at every vertex but is not convex; a
+ * square inside one of its points must come out whole, not be clipped
+ * to the inner pentagon. Exits on failure.
+ */
+static void checkStarWindow()
+{
+    std::vector<glm::vec2> star;
+    for (int i = 0; i < 5; i++) {
+        float a = 1.5707963f + 6.2831853f * (2 * i % 5) / 5;
+        star.push_back(glm::vec2(std::cos(a), std::sin(a)));
+    }
+    std::vector<glm::vec2> square = {{-0.02f, 0.82f}, {0.02f, 0.82f}, {0.02f, 0.86f}, {-0.02f, 0.86f}};
+
+    bool convex = polygonIsConvex(star.data(), star.size());
+    ClipWindow window(star);
+    std::vector<std::vector<glm::vec2>> pieces;
+    clipToWindow(square, window, pieces);
+    double area = pieces.size() == 1 ? std::fabs(polygonArea2(pieces[0].data(), pieces[0].size())) : 0.0;
+    if (convex || pieces.size() != 1 || std::fabs(area - 2 * 0.04 * 0.04) > 1e-6) {
+        fprintf(stderr, "pentagram window: convex %d, %zu pieces, area2 %g\n", convex, pieces.size(), area);
+        exit(1);
+    }
+    printf("pentagram window: not convex, square in a point kept whole\n");
+}
+
+/** General window clipping, grid against all n * m edge pairs. */
+static void benchWindow()
+{
+    checkStarWindow();
+
+    std::vector<std::vector<glm::vec2>> polygons = randomPolygons(2000, 32, 42, 0.3f);
+
+    printf("%d polygons, 3..32 vertices, polygons/s\n", (int)polygons.size());
+    printf("%-8s %8s %14s %14s %8s\n", "window", "edges", "grid", "naive", "speedup");
+    for (bool convex : {false, true}) {
+        for (int m : {16, 256, 4096}) {
+            ClipWindow window(starWindow(m, convex));
+            std::vector<std::vector<glm::vec2>> pieces;
+            double s[2];
+
+            for (int accelerated = 1; accelerated >= 0; accelerated--) {
+                int rounds = 0;
+                Clock::time_point t0 = Clock::now();
+                do {
+                    for (const std::vector<glm::vec2>& poly : polygons)
+                        clipToWindow(poly, window, pieces, accelerated);
+                    rounds++;
+                } while (secondsSince(t0) < 0.5);
+                s[accelerated] = secondsSince(t0) / rounds;
+            }
+            printf("%-8s %8d %14.0f %14.0f %7.1fx\n", convex ? "convex" : "concave", m,
+                   polygons.size() / s[1], polygons.size() / s[0], s[0] / s[1]);
+        }
+    }
+}
+
+/** Ear clipping against monotone decomposition on growing concave stars. */
+static void benchTriangulate()
+{
+    printf("%-8s %14s %14s %8s\n", "vertices", "ear clip ms", "monotone ms", "speedup");
+    for (int n : {100, 1000, 10000, 30000}) {
+        std::vector<glm::vec2> polygon = starWindow(n, false);
+        std::vector<uint32_t> indices;
+        double s[2];
+
+        for (int monotone = 0; monotone <= 1; monotone++) {
+            int rounds = 0;
+            Clock::time_point t0 = Clock::now();
+            do {
+                indices.clear();
+                if (monotone)
+                    triangulateMonotone(polygon.data(), polygon.size(), 0, indices);
+                else
+                    triangulateEarClip(polygon.data(), polygon.size(), 0, indices);
+                rounds++;
+            } while (secondsSince(t0) < 0.5);
+            s[monotone] = secondsSince(t0) / rounds;
+        }
+        printf("%-8d %14.3f %14.3f %7.1fx\n", n, s[0] * 1e3, s[1] * 1e3, s[0] / s[1]);
+    }
+}
+
+/**
+ * Exact Sutherland-Hodgman on integer input, as reference for the
+ * precision modes.
+ *
+ * Every vertex of the result is an input vertex, the crossing of an input
+ * edge with a rectangle line, or a corner, so it is a rational with
+ * 128-bit numerators and denominator. A point knows the input edge leaving
+ * it and the rectangle lines it is on; an edge between two points on the
+ * same line lies on that line, any other one on the input edge of its
+ * first point.
+ */
+struct ExactPoint
+{
+    __int128 x, y, d;  // (x / d, y / d), d > 0
+    int edge;          // input edge (edge, edge + 1) it starts, or -1
+    int vertex;        // input vertex it is, or -1
+    unsigned lines;    // rectangle lines it lies on: 1 << ClipEdge order
+};
+
+struct ExactClipper
+{
+    const std::vector<glm::i64vec2>* input;
+    int64_t bounds[4];  // x min, x max, y min, y max
+
+    unsigned linesOf(__int128 x, __int128 y, __int128 d) const
+    {
+        return (x == bounds[0] * d) | (x == bounds[1] * d) << 1 | (y == bounds[2] * d) << 2 |
+               (y == bounds[3] * d) << 3;
+    }
+
+    bool inside(const ExactPoint& p, int line) const
+    {
+        switch (line) {
+            case 0: return p.x >= bounds[0] * p.d;
+            case 1: return p.x <= bounds[1] * p.d;
+            case 2: return p.y >= bounds[2] * p.d;
+            default: return p.y <= bounds[3] * p.d;
+        }
+    }
+
+    ExactPoint intersect(const ExactPoint& s, const ExactPoint& e, int line) const
+    {
+        ExactPoint r;
+        unsigned common = s.lines & e.lines;
+        if (common) {
+            // Along a rectangle line: the crossing is a corner.
+            int along = __builtin_ctz(common);
+            int64_t cx = bounds[along < 2 ? along : line];
+            int64_t cy = bounds[along < 2 ? line : along];
+            r.x = cx;
+            r.y = cy;
+            r.d = 1;
+            r.edge = -1;
+        } else {
+            const std::vector<glm::i64vec2>& in = *input;
+            glm::i64vec2 p1 = in[s.edge], p2 = in[(s.edge + 1) % in.size()];
+            __int128 dx = p2.x - p1.x, dy = p2.y - p1.y;
+            if (line < 2) {
+                r.d = dx;
+                r.x = (__int128)bounds[line] * dx;
+                r.y = (__int128)p1.y * dx + dy * (bounds[line] - p1.x);
+            } else {
+                r.d = dy;
+                r.y = (__int128)bounds[line] * dy;
+                r.x = (__int128)p1.x * dy + dx * (bounds[line] - p1.y);
+            }
+            if (r.d < 0) {
+                r.x = -r.x;
+                r.y = -r.y;
+                r.d = -r.d;
+            }
+            r.edge = s.edge;
+        }
+        r.vertex = -1;
+        r.lines = linesOf(r.x, r.y, r.d);
+        return r;
+    }
+
+    std::vector<ExactPoint> clip(const std::vector<glm::i64vec2>& polygon)
+    {
+        input = &polygon;
+        std::vector<ExactPoint> points, next;
+        for (size_t i = 0; i < polygon.size(); i++) {
+            ExactPoint p = {polygon[i].x, polygon[i].y, 1, (int)i, (int)i, 0};
+            p.lines = linesOf(p.x, p.y, 1);
+            points.push_back(p);
+        }
+        for (int line = 0; line < 4 && !points.empty(); line++) {
+            next.clear();
+            ExactPoint S = points.back();
+            for (const ExactPoint& E : points) {
+                bool inS = inside(S, line), inE = inside(E, line);
+                if (inS)
+                    next.push_back(S);
+                if (inS != inE)
+                    next.push_back(intersect(S, E, line));
+                S = E;
+            }
+            points.swap(next);
+        }
+        return points;
+    }
+};
+
+/**
+ * Survey-sized coordinates: polygons of up to 50 m around origin, on a grid
+ * of 1/1024 m, so every input is exact in double and in fixed point. Some
+ * edges cross the left border almost vertically, 1/512 m wide.
+ */
+static std::vector<std::vector<glm::i64vec2>> gridPolygons(int count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> center(-40.0, 40.0);
+    std::uniform_real_distribution<double> radius(5.0, 50.0);
+    std::uniform_real_distribution<double> jitter(0.5, 1.0);
+    std::uniform_int_distribution<int> vertices(3, 16);
+
+    std::vector<std::vector<glm::i64vec2>> polygons(count);
+    for (std::vector<glm::i64vec2>& poly : polygons) {
+        double cx = center(rng), cy = center(rng), r = radius(rng);
+        int n = vertices(rng);
+        for (int i = 0; i < n; i++) {
+            double a = 6.283185307179586 * i / n, s = r * jitter(rng);
+            poly.push_back(glm::i64vec2(std::llround((cx + std::cos(a) * s) * 1024),
+                                        std::llround((cy + std::sin(a) * s) * 1024)));
+        }
+        if (rng() % 4 == 0 && n > 3) {
+            int i = rng() % n;
+            poly[i].x = -30 * 1024 + 1;
+            poly[(i + 1) % n].x = -30 * 1024 - 1;
+        }
+    }
+    return polygons;
+}
+
+/** Error and speed of one clipper against the exact clip. */
+template <typename T, typename Clip>
+static void benchPrecisionMode(const char* name, const std::vector<std::vector<glm::i64vec2>>& grid,
+                               const std::vector<std::vector<ExactPoint>>& exact, glm::dvec2 origin,
+                               glm::vec<2, T> (*convert)(glm::dvec2), glm::dvec2 (*back)(glm::vec<2, T>), Clip clip)
+{
+    typedef glm::vec<2, T> Point;
+
+    std::vector<std::vector<Point>> polygons;
+    for (const std::vector<glm::i64vec2>& poly : grid) {
+        std::vector<Point> converted;
+        for (glm::i64vec2 p : poly)
+            converted.push_back(convert(origin + glm::dvec2(p.x / 1024.0, p.y / 1024.0)));
+        polygons.push_back(converted);
+    }
+    Point pMin = convert(origin + glm::dvec2(-30.0, -30.0)), pMax = convert(origin + glm::dvec2(30.0, 30.0));
+
+    double maxError = 0.0, sumError = 0.0;
+    size_t vertices = 0, mismatches = 0;
+    for (size_t i = 0; i < polygons.size(); i++) {
+        const std::vector<Point>& out = clip(polygons[i].data(), polygons[i].size(), pMin, pMax);
+        if (out.size() != exact[i].size()) {
+            mismatches++;
+            continue;
+        }
+        for (size_t k = 0; k < out.size(); k++) {
+            const ExactPoint& e = exact[i][k];
+            glm::dvec2 p = back(out[k]) - origin;
+            double ex = (double)e.x / (double)e.d / 1024.0, ey = (double)e.y / (double)e.d / 1024.0;
+            double error = std::max(std::fabs(p.x - ex), std::fabs(p.y - ey));
+            maxError = std::max(maxError, error);
+            sumError += error;
+            vertices++;
+        }
+    }
+
+    int rounds = 0;
+    Clock::time_point t0 = Clock::now();
+    do {
+        for (const std::vector<Point>& poly : polygons)
+            clip(poly.data(), poly.size(), pMin, pMax);
+        rounds++;
+    } while (secondsSince(t0) < 0.5);
+    double s = secondsSince(t0) / rounds;
+
+    printf("%-8s %12.0f %12.3g %12.3g %10zu\n", name, polygons.size() / s, maxError,
+           vertices ? sumError / vertices : 0.0, mismatches);
+}
+
+static glm::vec2 toFloat(glm::dvec2 p) { return glm::vec2(p); }
+static glm::dvec2 fromFloat(glm::vec2 p) { return glm::dvec2(p); }
+static glm::dvec2 toDouble(glm::dvec2 p) { return p; }
+static glm::dvec2 fromDouble(glm::dvec2 p) { return p; }
+
+/** Every precision mode on local and on survey-sized (UTM) coordinates. */
+static void benchPrecision()
+{
+    const int count = 100000;
+    std::vector<std::vector<glm::i64vec2>> grid = gridPolygons(count, 42);
+
+    ExactClipper exactClipper;
+    exactClipper.bounds[0] = exactClipper.bounds[2] = -30 * 1024;
+    exactClipper.bounds[1] = exactClipper.bounds[3] = 30 * 1024;
+    std::vector<std::vector<ExactPoint>> exact;
+    for (const std::vector<glm::i64vec2>& poly : grid)
+        exact.push_back(exactClipper.clip(poly));
+
+    const glm::dvec2 origins[] = {glm::dvec2(0.0, 0.0), glm::dvec2(500000.0, 7000000.0)};
+    for (glm::dvec2 origin : origins) {
+        printf("%d polygons around (%.0f, %.0f) m, error against exact clip in m\n", count, origin.x, origin.y);
+        printf("%-8s %12s %12s %12s %10s\n", "mode", "polygons/s", "max error", "mean error", "mismatch");
+        ClipScratch scratch;
+        PreciseClipScratch<float> floatScratch;
+        PreciseClipScratch<double> doubleScratch;
+        PreciseClipScratch<int64_t> fixedScratch;
+
+        benchPrecisionMode<float>("scratch", grid, exact, origin, toFloat, fromFloat,
+            [&](const glm::vec2* p, size_t n, glm::vec2 lo, glm::vec2 hi) -> const std::vector<glm::vec2>& {
+                return sutherlandHodgman(p, n, lo, hi, scratch);
+            });
+        benchPrecisionMode<float>("float", grid, exact, origin, toFloat, fromFloat,
+            [&](const glm::vec2* p, size_t n, glm::vec2 lo, glm::vec2 hi) -> const std::vector<glm::vec2>& {
+                return sutherlandHodgmanPrecise(p, n, lo, hi, floatScratch);
+            });
+        benchPrecisionMode<double>("double", grid, exact, origin, toDouble, fromDouble,
+            [&](const glm::dvec2* p, size_t n, glm::dvec2 lo, glm::dvec2 hi) -> const std::vector<glm::dvec2>& {
+                return sutherlandHodgmanPrecise(p, n, lo, hi, doubleScratch);
+            });
+        benchPrecisionMode<int64_t>("fixed", grid, exact, origin, toFixed, fromFixed,
+            [&](const FixedPoint* p, size_t n, FixedPoint lo, FixedPoint hi) -> const std::vector<FixedPoint>& {
+                return sutherlandHodgmanPrecise(p, n, lo, hi, fixedScratch);
+            });
+        printf("\n");
+    }
+}
+
+/** Every clipper on the same polygons, clip window [-1, 1]. */
+static void benchClippers(const std::vector<std::vector<glm::vec2>>& polygons, int rounds)
+{
+    const glm::vec2 pMin(-1.0f, -1.0f), pMax(1.0f, 1.0f);
+
+    size_t trivial = 0;
+    for (const std::vector<glm::vec2>& poly : polygons) {
+        PolygonOutcodes codes = polygonOutcodes(poly.data(), poly.size(), pMin, pMax);
+        trivial += codes.any == 0 || codes.all != 0;
+    }
+    printf("%.1f%% trivially accepted or rejected\n", 100.0 * trivial / polygons.size());
+
+    {
+        size_t vertices = 0;
+        unsigned long a0 = allocations;
+        Clock::time_point t0 = Clock::now();
+        for (int r = 0; r < rounds; r++)
+            for (const std::vector<glm::vec2>& poly : polygons)
+                vertices += sutherlandHodgman(poly, pMin, pMax).size();
+        report("reference", polygons.size(), rounds, secondsSince(t0), allocations - a0, vertices);
+    }
+
+    {
+        ClipScratch scratch;
+        size_t vertices = 0;
+        unsigned long a0 = allocations;
+        Clock::time_point t0 = Clock::now();
+        for (int r = 0; r < rounds; r++)
+            for (const std::vector<glm::vec2>& poly : polygons)
+                vertices += sutherlandHodgman(poly.data(), poly.size(), pMin, pMax, scratch).size();
+        report("scratch", polygons.size(), rounds, secondsSince(t0), allocations - a0, vertices);
+    }
+
+    {
+        ClipScratch scratch;
+        size_t vertices = 0;
+        unsigned long a0 = allocations;
+        Clock::time_point t0 = Clock::now();
+        for (int r = 0; r < rounds; r++)
+            for (const std::vector<glm::vec2>& poly : polygons)
+                vertices += sutherlandHodgmanFused(poly.data(), poly.size(), pMin, pMax, scratch).size();
+        report("fused", polygons.size(), rounds, secondsSince(t0), allocations - a0, vertices);
+    }
+
+    {
+        ClipScratch scratch;
+        size_t vertices = 0;
+        unsigned long a0 = allocations;
+        Clock::time_point t0 = Clock::now();
+        for (int r = 0; r < rounds; r++)
+            for (const std::vector<glm::vec2>& poly : polygons)
+                vertices += sutherlandHodgmanTrivial(poly.data(), poly.size(), pMin, pMax, scratch).size;
+        report("trivial", polygons.size(), rounds, secondsSince(t0), allocations - a0, vertices);
+    }
+
+    PolygonSoA batch, clipped;
+    for (const std::vector<glm::vec2>& poly : polygons)
+        batch.add(poly.data(), poly.size());
+
+    for (ClipPath path : {CLIP_PATH_SCALAR, CLIP_PATH_SSE, CLIP_PATH_AVX}) {
+        if (path > clipBestPath())
+            continue;
+
+        char name[32];
+        snprintf(name, sizeof(name), "soa %s", clipPathName(path));
+
+        ClipBatchScratch scratch;
+        size_t vertices = 0;
+        unsigned long a0 = allocations;
+        Clock::time_point t0 = Clock::now();
+        for (int r = 0; r < rounds; r++) {
+            clipPolygonsSoA(batch, pMin, pMax, clipped, scratch, path);
+            vertices += clipped.x.size();
+        }
+        report(name, polygons.size(), rounds, secondsSince(t0), allocations - a0, vertices);
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "precision") == 0) {
+        benchPrecision();
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "triangulate") == 0) {
+        benchTriangulate();
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "window") == 0) {
+        benchWindow();
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "tiles") == 0) {
+        unsigned maxThreads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+        benchTiles(std::max(1u, maxThreads));
+        return 0;
+    }
+
+    int count       = argc > 1 ? atoi(argv[1]) : 100000;
+    int maxVertices = argc > 2 ? atoi(argv[2]) : 16;
+    int rounds      = argc > 3 ? atoi(argv[3]) : 10;
+
+    printf("%d polygons, 3..%d vertices, %d rounds\n", count, maxVertices, rounds);
+    benchClippers(randomPolygons(count, maxVertices, 42), rounds);
+
+    printf("\nsmall polygons (radius <= 0.05)\n");
+    benchClippers(randomPolygons(count, maxVertices, 42, 0.05f), rounds);
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file bench_instances.cpp
+ * Benchmark of the per-frame instance transform update of tarefa9 --cubes.
+ *
+ * Usage: bench_instances [cubes] [max threads]
+ *
+ * Prints the largest difference of each vector path from the scalar one,
+ * then the time of one update of all cubes for each path with 1 to max
+ * threads, and the memory bandwidth of the written rows. Draw time is
+ * measured by tarefa9 --cube-bench.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "instances.h"
+#include "thread_pool.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+/** Largest difference from the scalar path, at a time where angles reach thousands of radians. */
+static float maxError(const CubeField& field, InstancePath path)
+{
+    std::vector<float> expected(field.size() * INSTANCE_FLOATS), rows(expected.size());
+    updateInstances(field, 2000.0f, expected.data(), 0, field.size(), INSTANCE_SCALAR);
+    updateInstances(field, 2000.0f, rows.data(), 0, field.size(), path);
+
+    float error = 0.0f;
+    for (size_t i = 0; i < rows.size(); i++)
+        error = std::max(error, std::fabs(rows[i] - expected[i]));
+    return error / field.scale;
+}
+
+static double benchUpdate(const CubeField& field, ThreadPool& pool, InstancePath path, std::vector<float>& rows)
+{
+    int frames = 0;
+    Clock::time_point t0 = Clock::now();
+    do {
+        updateInstances(field, frames * 0.016f, rows.data(), pool, path);
+        frames++;
+    } while (secondsSince(t0) < 0.5);
+    return secondsSince(t0) / frames;
+}
+
+int main(int argc, char** argv)
+{
+    size_t cubes = argc > 1 ? atol(argv[1]) : 1000000;
+    unsigned maxThreads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+    if (maxThreads == 0) maxThreads = 1;
+
+    CubeField field;
+    makeCubeField(cubes, 3.0f, 0.17f, field);
+    std::vector<float> rows(cubes * INSTANCE_FLOATS);
+    std::vector<InstancePath> paths;
+    for (InstancePath path : {INSTANCE_SCALAR, INSTANCE_SSE2, INSTANCE_AVX2})
+        if (path <= instanceBestPath()) paths.push_back(path);
+
+    for (InstancePath path : paths)
+        if (path != INSTANCE_SCALAR)
+            printf("%-6s largest difference from scalar: %.2e\n", instancePathName(path), maxError(field, path));
+
+    printf("\n%zu cubes, %zu bytes per update, time per update (ms)\n", cubes, rows.size() * sizeof(float));
+    printf("threads");
+    for (InstancePath path : paths)
+        printf(" %10s", instancePathName(path));
+    printf("   GB/s (best)\n");
+
+    for (unsigned t = 1; t <= maxThreads; t *= 2) {
+        ThreadPool pool(t);
+        printf("%7u", t);
+        double best = 1e30;
+        for (InstancePath path : paths) {
+            double s = benchUpdate(field, pool, path, rows);
+            best = std::min(best, s);
+            printf(" %10.3f", s * 1e3);
+        }
+        printf("   %.2f\n", rows.size() * sizeof(float) / best * 1e-9);
+    }
+    return 0;
+}
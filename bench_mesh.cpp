@@ -0,0 +1,131 @@
+/**
+ * @file bench_mesh.cpp
+ * Vertex memory of triangle lists against indexed, packed meshes.
+ *
+ * Usage: bench_mesh [sphere slices]
+ *
+ * For the tarefa9 cube and a generated sphere, prints the bytes of the
+ * float triangle list and of the indexed, packed form, the vertex shader
+ * runs per triangle with a 32-entry post-transform cache, the largest
+ * error packing introduces and the time to index and pack. GPU draw time
+ * is measured by tarefa9 itself: compare "--stats" runs with and without
+ * "--expanded".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "mesh.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+/** Cube of tarefa9: 6 faces of 2 triangles, UVs 0..1 per face. */
+static std::vector<MeshVertex> cubeTriangles()
+{
+    std::vector<MeshVertex> v;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int side = -1; side <= 1; side += 2) {
+            glm::vec3 n(0.0f), u(0.0f), w(0.0f);
+            n[axis] = (float)side;
+            u[(axis + 1) % 3] = 1.0f;
+            w[(axis + 2) % 3] = 1.0f;
+            auto corner = [&](float a, float b) {
+                return MeshVertex{0.5f * n + (a - 0.5f) * u + (b - 0.5f) * w, n, glm::vec2(a, b)};
+            };
+            MeshVertex quad[6] = {corner(0, 0), corner(1, 0), corner(1, 1),
+                                  corner(1, 1), corner(0, 1), corner(0, 0)};
+            v.insert(v.end(), quad, quad + 6);
+        }
+    }
+    return v;
+}
+
+static const char* formatName(AttributeFormat f)
+{
+    switch (f) {
+        case ATTR_FLOAT:            return "float";
+        case ATTR_HALF:             return "half";
+        case ATTR_UNORM16:          return "unorm16";
+        case ATTR_SNORM_10_10_10_2: return "10:10:10:2";
+    }
+    return "?";
+}
+
+/** Largest error of the normals and UVs of a packed vertex array. */
+static void packingError(const std::vector<MeshVertex>& unique, const MeshFormat& f,
+                         const std::vector<uint8_t>& packed, double& normalError, double& uvError)
+{
+    normalError = uvError = 0.0;
+    for (size_t i = 0; i < unique.size(); i++) {
+        const uint8_t* p = packed.data() + i * f.stride;
+        glm::vec3 n = unique[i].normal;
+        if (f.normal == ATTR_SNORM_10_10_10_2) {
+            uint32_t bits;
+            memcpy(&bits, p + f.normalOffset, sizeof(bits));
+            n = unpackSnorm10(bits);
+        }
+        glm::vec2 uv = unique[i].uv;
+        uint16_t h[2];
+        memcpy(h, p + f.uvOffset, sizeof(h));
+        if (f.uv == ATTR_UNORM16)
+            uv = glm::vec2(h[0] / 65535.0f, h[1] / 65535.0f);
+        else if (f.uv == ATTR_HALF)
+            uv = glm::vec2(unpackHalf(h[0]), unpackHalf(h[1]));
+
+        glm::vec3 dn = glm::abs(n - unique[i].normal);
+        glm::vec2 duv = glm::abs(uv - unique[i].uv);
+        normalError = std::max(normalError, (double)std::max(dn.x, std::max(dn.y, dn.z)));
+        uvError = std::max(uvError, (double)std::max(duv.x, duv.y));
+    }
+}
+
+static void benchMesh(const char* name, const std::vector<MeshVertex>& triangles)
+{
+    size_t n = triangles.size();
+    std::vector<MeshVertex> unique;
+    std::vector<uint32_t> indices;
+    std::vector<uint8_t> packed;
+    MeshFormat f;
+
+    int reps = std::max(1, (int)(200000 / n));
+    Clock::time_point t0 = Clock::now();
+    for (int r = 0; r < reps; r++) {
+        indexMesh(triangles.data(), n, unique, indices);
+        f = chooseMeshFormat(unique.data(), unique.size());
+        packVertices(unique.data(), unique.size(), f, packed);
+    }
+    double s = secondsSince(t0) / reps;
+
+    size_t indexSize = unique.size() <= 65536 ? 2 : 4;
+    size_t before = n * sizeof(MeshVertex);
+    size_t after = packed.size() + indices.size() * indexSize;
+    double normalError, uvError;
+    packingError(unique, f, packed, normalError, uvError);
+
+    printf("%s: %zu triangles\n", name, n / 3);
+    printf("  triangle list  %8zu vertices x %2zu B              = %10zu B, %.2f shader runs/triangle\n",
+           n, sizeof(MeshVertex), before, 3.0);
+    printf("  indexed        %8zu vertices x %2zu B + %zu B indices = %10zu B, %.2f shader runs/triangle (%.0f%% less memory)\n",
+           unique.size(), f.stride, indexSize, after, averageCacheMissRatio(indices.data(), indices.size(), 32),
+           100.0 * (1.0 - (double)after / before));
+    printf("  normal %s (max error %.2g), uv %s (max error %.2g), built in %.3f ms\n",
+           formatName(f.normal), normalError, formatName(f.uv), uvError, s * 1e3);
+}
+
+int main(int argc, char** argv)
+{
+    int slices = argc > 1 ? atoi(argv[1]) : 512;
+
+    benchMesh("cube", cubeTriangles());
+    benchMesh("sphere", sphereTriangles(slices, slices / 2));
+    return 0;
+}
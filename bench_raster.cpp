@@ -0,0 +1,256 @@
+/**
+ * @file bench_raster.cpp
+ * Benchmarks for the circle rasterizer in raster.cpp.
+ *
+ * Usage: bench_raster [circles] [max radius] [frames]
+ *        bench_raster scaling [max threads]
+ *        bench_raster spans
+ *        bench_raster check [max radius]
+ *
+ * "check" compares bresenhamCirclesPixelsUnique and
+ * bresenhamCircleUniquePointCount with a std::set of bresenhamCircle's
+ * points for every radius from -1 to max radius - 1 (default 3000), and
+ * exits with status 1 on the first mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "raster.h"
+#include "thread_pool.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+/** Per-call push_back version, as tarefa11 used to build its circles. */
+static void benchPushBack(const std::vector<Circle>& circles, int frames)
+{
+    std::vector<glm::vec3> points;
+    size_t total = 0;
+
+    Clock::time_point t0 = Clock::now();
+    for (int f = 0; f < frames; f++) {
+        points = std::vector<glm::vec3>();
+        for (const Circle& c : circles)
+            bresenhamCircle(c.xc, c.yc, c.r, points);
+        total += points.size();
+    }
+    double s = secondsSince(t0);
+
+    printf("push_back  %12.0f circles/s  %8.2f Mpoints/s\n",
+           circles.size() * (double)frames / s, total / s * 1e-6);
+}
+
+/** Batched version: exact size up front, one pass into a single buffer. */
+static void benchBatched(const std::vector<Circle>& circles, int frames)
+{
+    std::vector<glm::vec3> points;
+    size_t total = 0;
+
+    Clock::time_point t0 = Clock::now();
+    for (int f = 0; f < frames; f++) {
+        points.resize(bresenhamCirclesPointCount(circles.data(), circles.size()));
+        total += bresenhamCircles(circles.data(), circles.size(), points.data());
+    }
+    double s = secondsSince(t0);
+
+    printf("batched    %12.0f circles/s  %8.2f Mpoints/s\n",
+           circles.size() * (double)frames / s, total / s * 1e-6);
+}
+
+/** Single large circle: push_back into a fresh vector. */
+static double benchLargePushBack(int r, int reps)
+{
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < reps; i++) {
+        std::vector<glm::vec3> points;
+        bresenhamCircle(0, 0, r, points);
+    }
+    return secondsSince(t0) / reps;
+}
+
+/** Single large circle: SoA output into pre-sized arrays. */
+static double benchLargeSoA(int r, int reps, RasterPath path)
+{
+    size_t n = bresenhamCirclePointCount(r);
+    std::vector<int> xs(n), ys(n);
+
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < reps; i++)
+        bresenhamCircleSoA(0, 0, r, xs.data(), ys.data(), path);
+    return secondsSince(t0) / reps;
+}
+
+/** Parallel generation of one circle for 1..maxThreads threads. */
+static void benchScaling(unsigned maxThreads)
+{
+    const int radii[] = {1000, 10000, 100000, 1000000, 10000000};
+
+    printf("parallel circle, time per circle (ms), path: %s\n", rasterPathName(rasterBestPath()));
+    printf("%8s", "threads");
+    for (int r : radii)
+        printf(" %16d", r);
+    printf("\n");
+
+    std::vector<double> base;
+    for (unsigned t = 1; t <= maxThreads; t++) {
+        ThreadPool pool(t);
+        printf("%8u", t);
+        for (size_t k = 0; k < sizeof(radii) / sizeof(radii[0]); k++) {
+            int r = radii[k];
+            size_t n = bresenhamCirclePointCount(r);
+            std::vector<int> xs(n), ys(n);
+            int reps = r >= 10000000 ? 3 : std::max(3, 20000000 / r);
+
+            bresenhamCircleParallel(0, 0, r, xs.data(), ys.data(), pool);
+            Clock::time_point t0 = Clock::now();
+            for (int i = 0; i < reps; i++)
+                bresenhamCircleParallel(0, 0, r, xs.data(), ys.data(), pool);
+            double s = secondsSince(t0) / reps;
+
+            if (t == 1) base.push_back(s);
+            printf(" %9.3f (%4.1fx)", s * 1e3, base[k] / s);
+        }
+        printf("\n");
+    }
+}
+
+/** Throughput of the span rasterizers for one shape size. */
+static void benchSpans(const char* name, int size, size_t maxSpans,
+                       const std::function<size_t(Span*)>& rasterize)
+{
+    std::vector<Span> spans(maxSpans);
+    int reps = std::max(10, 50000000 / (int)(maxSpans * size + 1));
+    size_t n = 0, pixels = 0;
+
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < reps; i++) {
+        n = rasterize(spans.data());
+        pixels += spanPixelCount(spans.data(), n);
+    }
+    double s = secondsSince(t0);
+
+    printf("%-8s %8d %14.2f %14.2f\n", name, size, n * (double)reps / s * 1e-6, pixels / s * 1e-6);
+}
+
+static void benchAllSpans()
+{
+    printf("%-8s %8s %14s %14s\n", "shape", "size", "Mspans/s", "Mpixels/s");
+    for (int r : {16, 256, 4096}) {
+        benchSpans("circle", r, filledCircleSpanCount(r),
+                   [&](Span* out) { return filledCircleSpans(0, 0, r, out); });
+        benchSpans("ellipse", r, filledEllipseSpanCount(2 * r, r),
+                   [&](Span* out) { return filledEllipseSpans(0, 0, 2 * r, r, out); });
+        benchSpans("arc", r, arcSpanMaxCount(r),
+                   [&](Span* out) { return arcSpans(0, 0, r, 30.0f, 300.0f, out); });
+    }
+}
+
+/** Unique pixels against a set-based reference, first occurrence kept. */
+static bool checkUnique(int maxRadius)
+{
+    std::vector<glm::vec3> points;
+    std::vector<int32_t> xy32;
+    std::vector<int16_t> xy16;
+    for (int r = -1; r < maxRadius; r++) {
+        Circle c{r % 7 - 3, 5 - r % 11, r};
+        points.clear();
+        bresenhamCircle(c.xc, c.yc, c.r, points);
+
+        std::set<std::pair<int, int>> seen;
+        std::vector<int> expected;
+        for (const glm::vec3& p : points) {
+            if (seen.insert(std::make_pair((int)p.x, (int)p.y)).second) {
+                expected.push_back((int)p.x);
+                expected.push_back((int)p.y);
+            }
+        }
+
+        size_t predicted = bresenhamCircleUniquePointCount(r);
+        size_t predictedBatch = bresenhamCirclesUniquePointCount(&c, 1);
+        // Sized for the reference too, so a wrong prediction cannot overflow.
+        size_t capacity = 2 * std::max(predicted, seen.size());
+        xy32.assign(capacity, 0);
+        size_t n32 = bresenhamCirclesPixelsUnique(&c, 1, xy32.data());
+        bool ok = predicted == seen.size() && predictedBatch == seen.size() && n32 == seen.size() &&
+                  std::equal(expected.begin(), expected.end(), xy32.begin());
+
+        if (ok && circlesFitInt16(&c, 1)) {
+            xy16.assign(capacity, 0);
+            size_t n16 = bresenhamCirclesPixelsUnique(&c, 1, xy16.data());
+            ok = n16 == seen.size() && std::equal(expected.begin(), expected.end(), xy16.begin());
+        }
+        if (!ok) {
+            fprintf(stderr, "radius %d: %zu unique pixels, predicted %zu, written %zu\n", r, seen.size(), predicted,
+                    n32);
+            return false;
+        }
+    }
+    printf("unique pixels match the set reference for radius -1..%d\n", maxRadius - 1);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && strcmp(argv[1], "check") == 0)
+        return checkUnique(argc > 2 ? atoi(argv[2]) : 3000) ? 0 : 1;
+
+    if (argc > 1 && strcmp(argv[1], "spans") == 0) {
+        benchAllSpans();
+        return 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "scaling") == 0) {
+        unsigned maxThreads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+        benchScaling(std::max(1u, maxThreads));
+        return 0;
+    }
+
+    int count     = argc > 1 ? atoi(argv[1]) : 20000;
+    int maxRadius = argc > 2 ? atoi(argv[2]) : 64;
+    int frames    = argc > 3 ? atoi(argv[3]) : 50;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> pos(0, 1920);
+    std::uniform_int_distribution<int> rad(1, maxRadius);
+
+    std::vector<Circle> circles(count);
+    for (Circle& c : circles)
+        c = Circle{pos(rng), pos(rng), rad(rng)};
+
+    printf("%d circles, radius 1..%d, %d frames\n", count, maxRadius, frames);
+    benchPushBack(circles, frames);
+    benchBatched(circles, frames);
+
+    size_t all = bresenhamCirclesPointCount(circles.data(), circles.size());
+    size_t unique = bresenhamCirclesUniquePointCount(circles.data(), circles.size());
+    printf("unique     %zu of %zu points (%.1f%% fewer)\n", unique, all, 100.0 * (all - unique) / all);
+
+    printf("\nlarge radius, time per circle (us), best path: %s\n", rasterPathName(rasterBestPath()));
+    printf("%10s %12s %12s %12s %12s\n", "radius", "push_back", "scalar", "sse2", "avx2");
+    for (int r : {1000, 10000, 100000, 1000000}) {
+        int reps = r >= 1000000 ? 5 : 20000000 / r;
+        printf("%10d %12.1f", r, benchLargePushBack(r, reps) * 1e6);
+        for (RasterPath path : {RASTER_SCALAR, RASTER_SSE2, RASTER_AVX2}) {
+            if (path > rasterBestPath())
+                printf(" %12s", "n/a");
+            else
+                printf(" %12.1f", benchLargeSoA(r, reps, path) * 1e6);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file bench_texture.cpp
+ * Benchmarks for texture decoding at startup.
+ *
+ * Usage: bench_texture [textures] [max threads] [file]
+ *        bench_texture cooked file.tex [textures] [image]
+ *        bench_texture mips [max threads] [size]
+ *        bench_texture atlas [images] [layer size]
+ *
+ * Decodes the file (container.jpg by default) the given number of times,
+ * first in a loop on one thread, as tarefa9 --sync does before its first
+ * frame, then with an ImageDecoder of 1 to max threads. For each, prints
+ * when the first image was ready, which bounds how soon a real texture
+ * can replace the placeholder, and when all were. Upload and mipmap time
+ * are not included; tarefa9 prints the full startup times.
+ *
+ * "cooked" compares, per texture, decoding the image (container.jpg by
+ * default) and building its mip chain on the CPU against mapping a file
+ * from texture_cooker and reading every level once, as the upload does.
+ * "mips" times buildMipChain on a size x size RGBA image with 1 to max
+ * threads.
+ * "atlas" packs images of 8 to 64 pixels a side, as tarefa9 --sprites
+ * makes, into layers of a texture array and prints how full they are
+ * and the draws and binds per frame with and without the atlas.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include "atlas.h"
+#include "cooked_texture.h"
+#include "image_decoder.h"
+#include "thread_pool.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+/** stbi_load in a loop, as before the first frame. */
+static void benchSerial(const char* path, int textures)
+{
+    double first = 0.0;
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < textures; i++) {
+        int w, h, c;
+        unsigned char* pixels = stbi_load(path, &w, &h, &c, 0);
+        if (!pixels) {
+            fprintf(stderr, "cannot decode %s\n", path);
+            exit(1);
+        }
+        stbi_image_free(pixels);
+        if (i == 0) first = msSince(t0);
+    }
+    double all = msSince(t0);
+
+    printf("serial      first %8.1f ms  all %8.1f ms  %7.1f textures/s\n", first, all, textures / all * 1e3);
+}
+
+static void benchDecoder(const char* path, int textures, unsigned threads)
+{
+    Clock::time_point t0 = Clock::now();
+    ImageDecoder decoder(threads);
+    for (int i = 0; i < textures; i++)
+        decoder.push(i, path);
+
+    double first = -1.0;
+    DecodedImage image;
+    while (decoder.wait(image)) {
+        if (first < 0.0) first = msSince(t0);
+        freeImage(image);
+    }
+    double all = msSince(t0);
+
+    printf("%2u threads  first %8.1f ms  all %8.1f ms  %7.1f textures/s\n", threads, first, all,
+           textures / all * 1e3);
+}
+
+static void benchCooked(const char* cookedPath, int textures, const char* imagePath)
+{
+    MipChain chain;
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < textures; i++) {
+        int w, h, c;
+        unsigned char* pixels = stbi_load(imagePath, &w, &h, &c, 0);
+        if (!pixels) {
+            fprintf(stderr, "cannot decode %s\n", imagePath);
+            exit(1);
+        }
+        buildMipChain(pixels, w, h, c, false, NULL, chain);
+        stbi_image_free(pixels);
+    }
+    double decodeMs = msSince(t0) / textures;
+
+    // Each level is read once, as glTexImage2D copies it out of the mapping.
+    std::vector<uint8_t> staging;
+    t0 = Clock::now();
+    for (int i = 0; i < textures; i++) {
+        CookedTexture cooked;
+        if (!cooked.open(cookedPath)) exit(1);
+        for (uint32_t l = 0; l < cooked.header().levels; l++) {
+            staging.resize(cooked.level(l).size);
+            memcpy(staging.data(), cooked.levelPixels(l), staging.size());
+        }
+    }
+    double cookedMs = msSince(t0) / textures;
+
+    printf("stbi_load + mips %8.3f ms/texture\n", decodeMs);
+    printf("cooked, mapped   %8.3f ms/texture (%.0fx faster)\n", cookedMs, decodeMs / cookedMs);
+}
+
+static void benchMips(unsigned maxThreads, uint32_t size)
+{
+    std::vector<uint8_t> pixels((size_t)size * size * 4);
+    std::mt19937 rng(1);
+    for (uint8_t& p : pixels)
+        p = (uint8_t)rng();
+
+    for (int linear = 0; linear < 2; linear++) {
+        for (unsigned t = 1; t <= maxThreads; t *= 2) {
+            ThreadPool pool(t);
+            MipChain chain;
+            Clock::time_point t0 = Clock::now();
+            buildMipChain(pixels.data(), size, size, 4, linear, &pool, chain);
+            double ms = msSince(t0);
+            printf("%s %2u threads  %8.2f ms  %7.1f Mpixels/s\n", linear ? "linear light" : "box         ", t, ms,
+                   (double)size * size / ms * 1e-3);
+        }
+    }
+}
+
+static void benchAtlas(int images, int size)
+{
+    const int padding = 4;
+    std::vector<glm::ivec2> sizes(images);
+    std::mt19937 rng(42);
+    size_t area = 0;
+    for (glm::ivec2& s : sizes) {
+        s = glm::ivec2(8 + rng() % 57, 8 + rng() % 57);
+        area += (size_t)(s.x + 2 * padding) * (s.y + 2 * padding);
+    }
+
+    std::vector<AtlasRect> rects;
+    Clock::time_point t0 = Clock::now();
+    int layers = packAtlas(sizes, size, padding, rects);
+    double packMs = msSince(t0);
+    if (layers < 0) {
+        fprintf(stderr, "an image does not fit in a %d x %d layer\n", size, size);
+        exit(1);
+    }
+
+    std::vector<uint8_t> pixels((size_t)size * size * 4 * layers);
+    std::vector<uint8_t> image(64 * 64 * 4, 255);
+    t0 = Clock::now();
+    for (const AtlasRect& r : rects)
+        blitToAtlas(&pixels[(size_t)r.layer * size * size * 4], size, 4, image.data(), r, padding);
+    double blitMs = msSince(t0);
+
+    printf("%d images in %d layers of %d x %d, %.1f%% full; pack %.2f ms, blit %.2f ms\n", images, layers, size,
+           size, 100.0 * area / ((double)size * size * layers), packMs, blitMs);
+    printf("per frame: %d draws and %d binds before, 1 draw and 1 bind with the atlas\n", images, images);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 2 && strcmp(argv[1], "cooked") == 0) {
+        benchCooked(argv[2], argc > 3 ? atoi(argv[3]) : 100, argc > 4 ? argv[4] : "container.jpg");
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "mips") == 0) {
+        unsigned maxThreads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+        benchMips(maxThreads ? maxThreads : 1, argc > 3 ? atoi(argv[3]) : 4096);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "atlas") == 0) {
+        benchAtlas(argc > 2 ? atoi(argv[2]) : 1000, argc > 3 ? atoi(argv[3]) : 1024);
+        return 0;
+    }
+
+    int textures = argc > 1 ? atoi(argv[1]) : 100;
+    unsigned maxThreads = argc > 2 ? atoi(argv[2]) : std::thread::hardware_concurrency();
+    const char* path = argc > 3 ? argv[3] : "container.jpg";
+    if (maxThreads == 0) maxThreads = 1;
+
+    benchSerial(path, textures);
+    for (unsigned t = 1; t <= maxThreads; t *= 2)
+        benchDecoder(path, textures, t);
+    return 0;
+}
@@ -0,0 +1,628 @@
+/**
+ * @file clip.cpp
+ * Polygon clipping against an axis-aligned rectangle (Sutherland-Hodgman).
+ */
+
+#include <string.h>
+#include <algorithm>
+#include "clip.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CLIP_X86 1
+#endif
+
+std::vector<glm::vec2> sutherlandHodgman(const std::vector<glm::vec2>& polygon, glm::vec2 pMin, glm::vec2 pMax)
+{
+    enum Edge { LEFT, RIGHT, BOTTOM, TOP };
+
+    auto inside = [&](const glm::vec2& p, Edge edge) -> bool {
+        switch (edge) {
+            case LEFT:   return p.x >= pMin.x;
+            case RIGHT:  return p.x <= pMax.x;
+            case BOTTOM: return p.y >= pMin.y;
+            case TOP:    return p.y <= pMax.y;
+        }
+        return false;
+    };
+
+    auto intersection = [&](const glm::vec2& p1, const glm::vec2& p2, Edge edge) -> glm::vec2 {
+        float x = 0.0f, y = 0.0f;
+        float dx = p2.x - p1.x;
+        float dy = p2.y - p1.y;
+
+        switch (edge) {
+            case LEFT:
+                x = pMin.x;
+                y = p1.y + dy * (pMin.x - p1.x) / dx;
+                break;
+            case RIGHT:
+                x = pMax.x;
+                y = p1.y + dy * (pMax.x - p1.x) / dx;
+                break;
+            case BOTTOM:
+                y = pMin.y;
+                x = p1.x + dx * (pMin.y - p1.y) / dy;
+                break;
+            case TOP:
+                y = pMax.y;
+                x = p1.x + dx * (pMax.y - p1.y) / dy;
+                break;
+        }
+        return glm::vec2(x, y);
+    };
+
+    auto clipPolygon = [&](const std::vector<glm::vec2>& input, Edge edge) -> std::vector<glm::vec2> {
+        std::vector<glm::vec2> output;
+        if (input.empty()) return output;
+
+        glm::vec2 S = input.back();
+
+        for (const glm::vec2& E : input) {
+            if ( !inside(S, edge) && inside(E, edge)) {
+                output.push_back(intersection(S, E, edge));                
+            } else if (inside(S, edge) && inside(E, edge) ) {
+                output.push_back(S);
+            }else if (inside(S, edge) && !inside(E, edge)){
+                output.push_back(S);
+                output.push_back(intersection(S, E, edge));
+            } else if (!inside(S, edge) && !inside(E, edge)) {
+                // Do nothing, both points are outside
+            }
+            S = E;
+        }
+
+        return output;
+    };
+
+    std::vector<glm::vec2> output = polygon;
+
+    for (Edge edge : {LEFT, RIGHT, BOTTOM, TOP}) {
+        output = clipPolygon(output, edge);
+        if (output.empty()) break;
+    }
+
+    return output;
+}
+
+enum ClipEdge { CLIP_LEFT, CLIP_RIGHT, CLIP_BOTTOM, CLIP_TOP };
+
+/** Same test as the inside lambda of sutherlandHodgman. */
+template <ClipEdge edge>
+static inline bool insideEdge(const glm::vec2& p, glm::vec2 pMin, glm::vec2 pMax)
+{
+    switch (edge) {
+        case CLIP_LEFT:   return p.x >= pMin.x;
+        case CLIP_RIGHT:  return p.x <= pMax.x;
+        case CLIP_BOTTOM: return p.y >= pMin.y;
+        case CLIP_TOP:    return p.y <= pMax.y;
+    }
+    return false;
+}
+
+/** Same arithmetic as the intersection lambda of sutherlandHodgman. */
+template <ClipEdge edge>
+static inline glm::vec2 intersectEdge(const glm::vec2& p1, const glm::vec2& p2, glm::vec2 pMin, glm::vec2 pMax)
+{
+    float dx = p2.x - p1.x;
+    float dy = p2.y - p1.y;
+
+    switch (edge) {
+        case CLIP_LEFT:   return glm::vec2(pMin.x, p1.y + dy * (pMin.x - p1.x) / dx);
+        case CLIP_RIGHT:  return glm::vec2(pMax.x, p1.y + dy * (pMax.x - p1.x) / dx);
+        case CLIP_BOTTOM: return glm::vec2(p1.x + dx * (pMin.y - p1.y) / dy, pMin.y);
+        case CLIP_TOP:    return glm::vec2(p1.x + dx * (pMax.y - p1.y) / dy, pMax.y);
+    }
+    return p1;
+}
+
+/** One Sutherland-Hodgman pass; output keeps its capacity. */
+template <ClipEdge edge>
+static void clipPass(const glm::vec2* input, size_t n, glm::vec2 pMin, glm::vec2 pMax, std::vector<glm::vec2>& output)
+{
+    output.clear();
+    if (n == 0) return;
+
+    glm::vec2 S = input[n - 1];
+    bool inS = insideEdge<edge>(S, pMin, pMax);
+
+    for (size_t i = 0; i < n; i++) {
+        const glm::vec2& E = input[i];
+        bool inE = insideEdge<edge>(E, pMin, pMax);
+
+        if (inS)
+            output.push_back(S);
+        if (inS != inE)
+            output.push_back(intersectEdge<edge>(S, E, pMin, pMax));
+
+        S = E;
+        inS = inE;
+    }
+}
+
+const std::vector<glm::vec2>& sutherlandHodgman(const glm::vec2* polygon, size_t n, glm::vec2 pMin, glm::vec2 pMax,
+                                                ClipScratch& scratch)
+{
+    std::vector<glm::vec2>& a = scratch.buffers[0];
+    std::vector<glm::vec2>& b = scratch.buffers[1];
+    a.reserve(n + 4);
+    b.reserve(n + 4);
+
+    // The first pass reads the input directly, so it is never copied.
+    clipPass<CLIP_LEFT>(polygon, n, pMin, pMax, a);
+    if (a.empty()) return a;
+    clipPass<CLIP_RIGHT>(a.data(), a.size(), pMin, pMax, b);
+    if (b.empty()) return b;
+    clipPass<CLIP_BOTTOM>(b.data(), b.size(), pMin, pMax, a);
+    if (a.empty()) return a;
+    clipPass<CLIP_TOP>(a.data(), a.size(), pMin, pMax, b);
+    return b;
+}
+
+PolygonOutcodes polygonOutcodes(const glm::vec2* polygon, size_t n, glm::vec2 pMin, glm::vec2 pMax)
+{
+    unsigned any = 0, all = OUT_LEFT | OUT_RIGHT | OUT_BOTTOM | OUT_TOP;
+    size_t i = 0;
+
+#ifdef CLIP_X86
+    // Two vertices (x0, y0, x1, y1) per register. Lanes of lo are set when
+    // out of LEFT (x) or BOTTOM (y), lanes of hi when out of RIGHT or TOP.
+    const __m128 lo = _mm_setr_ps(pMin.x, pMin.y, pMin.x, pMin.y);
+    const __m128 hi = _mm_setr_ps(pMax.x, pMax.y, pMax.x, pMax.y);
+    __m128 anyLo = _mm_setzero_ps(), anyHi = _mm_setzero_ps();
+    __m128 allLo = _mm_castsi128_ps(_mm_set1_epi32(-1)), allHi = allLo;
+
+    for (; i + 2 <= n; i += 2) {
+        __m128 p = _mm_loadu_ps(&polygon[i].x);
+        __m128 outLo = _mm_cmpnge_ps(p, lo);
+        __m128 outHi = _mm_cmpnle_ps(p, hi);
+        anyLo = _mm_or_ps(anyLo, outLo);
+        anyHi = _mm_or_ps(anyHi, outHi);
+        allLo = _mm_and_ps(allLo, outLo);
+        allHi = _mm_and_ps(allHi, outHi);
+    }
+
+    auto codes = [](int lo, int hi) -> unsigned {
+        return (lo & 1 ? OUT_LEFT : 0) | (lo & 2 ? OUT_BOTTOM : 0) | (hi & 1 ? OUT_RIGHT : 0) | (hi & 2 ? OUT_TOP : 0);
+    };
+    if (i > 0) {
+        int aLo = _mm_movemask_ps(anyLo), aHi = _mm_movemask_ps(anyHi);
+        int lLo = _mm_movemask_ps(allLo), lHi = _mm_movemask_ps(allHi);
+        any = codes(aLo | aLo >> 2, aHi | aHi >> 2);
+        all = codes(lLo & lLo >> 2, lHi & lHi >> 2);
+    }
+#endif
+
+    for (; i < n; i++) {
+        const glm::vec2& p = polygon[i];
+        unsigned code = (p.x >= pMin.x ? 0 : OUT_LEFT) | (p.x <= pMax.x ? 0 : OUT_RIGHT) |
+                        (p.y >= pMin.y ? 0 : OUT_BOTTOM) | (p.y <= pMax.y ? 0 : OUT_TOP);
+        any |= code;
+        all &= code;
+    }
+
+    if (n == 0) all = 0;
+    return PolygonOutcodes{any, all};
+}
+
+/** clipPass from input into output, then output becomes the next input. */
+template <ClipEdge edge>
+static void chainPass(const glm::vec2*& input, size_t& n, glm::vec2 pMin, glm::vec2 pMax,
+                      std::vector<glm::vec2>& output, int& next)
+{
+    if (n == 0) return;
+    clipPass<edge>(input, n, pMin, pMax, output);
+    input = output.data();
+    n = output.size();
+    next ^= 1;
+}
+
+ClipView sutherlandHodgmanTrivial(const glm::vec2* polygon, size_t n, glm::vec2 pMin, glm::vec2 pMax,
+                                  ClipScratch& scratch)
+{
+    PolygonOutcodes codes = polygonOutcodes(polygon, n, pMin, pMax);
+    if (codes.any == 0) return ClipView{polygon, n};
+    if (codes.all != 0) return ClipView{polygon, 0};
+
+    scratch.buffers[0].reserve(n + 4);
+    scratch.buffers[1].reserve(n + 4);
+
+    // Passes over the crossed edges only; the first reads the input.
+    const glm::vec2* input = polygon;
+    size_t m = n;
+    int k = 0;
+    if (codes.any & OUT_LEFT)
+        chainPass<CLIP_LEFT>(input, m, pMin, pMax, scratch.buffers[k], k);
+    if (codes.any & OUT_RIGHT)
+        chainPass<CLIP_RIGHT>(input, m, pMin, pMax, scratch.buffers[k], k);
+    if (codes.any & OUT_BOTTOM)
+        chainPass<CLIP_BOTTOM>(input, m, pMin, pMax, scratch.buffers[k], k);
+    if (codes.any & OUT_TOP)
+        chainPass<CLIP_TOP>(input, m, pMin, pMax, scratch.buffers[k], k);
+
+    return ClipView{input, m};
+}
+
+size_t clipEdgeToRectangle(glm::vec2 p, glm::vec2 q, glm::vec2 pMin, glm::vec2 pMax, glm::vec2* out)
+{
+    glm::vec2 d = q - p;
+    float t[4];
+    size_t k = 0;
+
+    // Crossings with the four border lines, where the clamp changes.
+    const float bounds[4] = {pMin.x, pMax.x, pMin.y, pMax.y};
+    for (int i = 0; i < 4; i++) {
+        float a = i < 2 ? p.x : p.y;
+        float da = i < 2 ? d.x : d.y;
+        if (da == 0.0f) continue;
+        float s = (bounds[i] - a) / da;
+        if (s > 0.0f && s < 1.0f) {
+            size_t j = k++;
+            for (; j > 0 && t[j - 1] > s; j--)
+                t[j] = t[j - 1];
+            t[j] = s;
+        }
+    }
+
+    size_t m = 0;
+    for (size_t i = 0; i < k; i++)
+        out[m++] = glm::clamp(p + d * t[i], pMin, pMax);
+    out[m++] = glm::clamp(q, pMin, pMax);
+    return m;
+}
+
+/**
+ * The four edge passes as one pipeline, each stage keeping only its first
+ * and previous vertex.
+ *
+ * A stage emits the contribution of edge (prev, E) as soon as E arrives,
+ * and the closing edge (last, first) on flush, while the reference emits
+ * the closing edge first. Each stage output is therefore a rotation of the
+ * reference one. To undo it, a mark travels down the pipeline in front of
+ * the contribution that starts the reference order; its position in the
+ * final output is the rotation to remove.
+ */
+struct ClipPipeline
+{
+    struct Stage
+    {
+        glm::vec2 first, prev;
+        bool inFirst, inPrev;
+        bool started = false;
+        bool markNext = false;
+        bool markClosing = false;
+    };
+
+    glm::vec2 pMin, pMax;
+    Stage stages[4];
+    std::vector<glm::vec2>* out;
+    size_t markPos = 0;
+
+    template <int edge> void push(const glm::vec2& E);
+    template <int edge> void mark();
+    template <int edge> void flush();
+    template <int edge> void emitEdge(Stage& s, const glm::vec2& E, bool inE);
+};
+
+template <int edge>
+inline void ClipPipeline::emitEdge(Stage& s, const glm::vec2& E, bool inE)
+{
+    if (s.markNext) {
+        s.markNext = false;
+        mark<edge + 1>();
+    }
+    if (s.inPrev)
+        push<edge + 1>(s.prev);
+    if (s.inPrev != inE)
+        push<edge + 1>(intersectEdge<(ClipEdge)edge>(s.prev, E, pMin, pMax));
+}
+
+template <int edge>
+inline void ClipPipeline::push(const glm::vec2& E)
+{
+    Stage& s = stages[edge];
+    bool inE = insideEdge<(ClipEdge)edge>(E, pMin, pMax);
+
+    if (!s.started) {
+        s.first = E;
+        s.inFirst = inE;
+        s.started = true;
+    } else {
+        emitEdge<edge>(s, E, inE);
+    }
+    s.prev = E;
+    s.inPrev = inE;
+}
+
+template <>
+inline void ClipPipeline::push<4>(const glm::vec2& E)
+{
+    out->push_back(E);
+}
+
+/** Marks the next edge of the stage, or its closing edge if none came yet. */
+template <int edge>
+inline void ClipPipeline::mark()
+{
+    Stage& s = stages[edge];
+    if (s.started)
+        s.markNext = true;
+    else
+        s.markClosing = true;
+}
+
+template <>
+inline void ClipPipeline::mark<4>()
+{
+    markPos = out->size();
+}
+
+template <int edge>
+inline void ClipPipeline::flush()
+{
+    Stage& s = stages[edge];
+    if (s.started) {
+        s.markNext |= s.markClosing;
+        emitEdge<edge>(s, s.first, s.inFirst);
+    }
+    flush<edge + 1>();
+}
+
+template <>
+inline void ClipPipeline::flush<4>()
+{
+}
+
+const std::vector<glm::vec2>& sutherlandHodgmanFused(const glm::vec2* polygon, size_t n, glm::vec2 pMin,
+                                                     glm::vec2 pMax, ClipScratch& scratch)
+{
+    std::vector<glm::vec2>& out = scratch.buffers[0];
+    out.clear();
+    out.reserve(n + 4);
+
+    ClipPipeline pipeline;
+    pipeline.pMin = pMin;
+    pipeline.pMax = pMax;
+    pipeline.out = &out;
+
+    // The reference starts at the closing edge of the input.
+    pipeline.mark<CLIP_LEFT>();
+    for (size_t i = 0; i < n; i++)
+        pipeline.push<CLIP_LEFT>(polygon[i]);
+    pipeline.flush<CLIP_LEFT>();
+
+    std::rotate(out.begin(), out.begin() + pipeline.markPos, out.end());
+    return out;
+}
+
+void PolygonSoA::clear()
+{
+    x.clear();
+    y.clear();
+    offsets.resize(1);
+    offsets[0] = 0;
+}
+
+void PolygonSoA::add(const glm::vec2* points, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        x.push_back(points[i].x);
+        y.push_back(points[i].y);
+    }
+    offsets.push_back((uint32_t)x.size());
+}
+
+ClipPath clipBestPath()
+{
+#ifdef CLIP_X86
+    if (__builtin_cpu_supports("avx")) return CLIP_PATH_AVX;
+    if (__builtin_cpu_supports("sse")) return CLIP_PATH_SSE;
+#endif
+    return CLIP_PATH_SCALAR;
+}
+
+const char* clipPathName(ClipPath path)
+{
+    switch (path) {
+        case CLIP_PATH_AUTO:   return "auto";
+        case CLIP_PATH_SCALAR: return "scalar";
+        case CLIP_PATH_SSE:    return "sse";
+        case CLIP_PATH_AVX:    return "avx";
+    }
+    return "?";
+}
+
+/*
+ * Inside masks: bit j of mask[b] is set when vertex 8b + j is inside, i.e.
+ * v >= bound (lower edges) or v <= bound (upper edges).
+ */
+
+static void insideMaskScalar(const float* v, size_t n, float bound, bool lower, uint8_t* mask)
+{
+    for (size_t b = 0; b * 8 < n; b++) {
+        uint8_t m = 0;
+        for (size_t j = 0; j < 8 && b * 8 + j < n; j++) {
+            float p = v[b * 8 + j];
+            if (lower ? p >= bound : p <= bound)
+                m |= 1 << j;
+        }
+        mask[b] = m;
+    }
+}
+
+#ifdef CLIP_X86
+static void insideMaskSSE(const float* v, size_t n, float bound, bool lower, uint8_t* mask)
+{
+    const __m128 k = _mm_set1_ps(bound);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_loadu_ps(v + i);
+        __m128 b = _mm_loadu_ps(v + i + 4);
+        __m128 ma = lower ? _mm_cmpge_ps(a, k) : _mm_cmple_ps(a, k);
+        __m128 mb = lower ? _mm_cmpge_ps(b, k) : _mm_cmple_ps(b, k);
+        mask[i / 8] = (uint8_t)(_mm_movemask_ps(ma) | (_mm_movemask_ps(mb) << 4));
+    }
+    if (i < n)
+        insideMaskScalar(v + i, n - i, bound, lower, mask + i / 8);
+}
+
+__attribute__((target("avx")))
+static void insideMaskAVX(const float* v, size_t n, float bound, bool lower, uint8_t* mask)
+{
+    const __m256 k = _mm256_set1_ps(bound);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 a = _mm256_loadu_ps(v + i);
+        __m256 m = lower ? _mm256_cmp_ps(a, k, _CMP_GE_OQ) : _mm256_cmp_ps(a, k, _CMP_LE_OQ);
+        mask[i / 8] = (uint8_t)_mm256_movemask_ps(m);
+    }
+    if (i < n) {
+        // Tail through a padded copy; calling the scalar version from here
+        // would skip the vzeroupper on exit.
+        float tail[8] = {};
+        memcpy(tail, v + i, (n - i) * sizeof(float));
+        __m256 a = _mm256_loadu_ps(tail);
+        __m256 m = lower ? _mm256_cmp_ps(a, k, _CMP_GE_OQ) : _mm256_cmp_ps(a, k, _CMP_LE_OQ);
+        mask[i / 8] = (uint8_t)(_mm256_movemask_ps(m) & ((1 << (n - i)) - 1));
+    }
+}
+#endif
+
+static void insideMask(const float* v, size_t n, float bound, bool lower, uint8_t* mask, ClipPath path)
+{
+    switch (path) {
+#ifdef CLIP_X86
+        case CLIP_PATH_AVX: insideMaskAVX(v, n, bound, lower, mask); break;
+        case CLIP_PATH_SSE: insideMaskSSE(v, n, bound, lower, mask); break;
+#endif
+        default:            insideMaskScalar(v, n, bound, lower, mask); break;
+    }
+}
+
+/**
+ * One edge pass over a polygon in SoA form.
+ *
+ * a holds the coordinate tested against the edge and o the other one (x
+ * and y for LEFT/RIGHT, swapped for BOTTOM/TOP). Vertex i contributes
+ * itself if inside and the intersection with vertex i + 1 if exactly one
+ * of them is inside; like the reference, output starts at vertex n - 1.
+ *
+ * @return Number of output vertices.
+ */
+static size_t clipPassSoA(const float* a, const float* o, size_t n, float bound, bool lower,
+                          float* outA, float* outO, uint8_t* mask, ClipPath path)
+{
+    insideMask(a, n, bound, lower, mask, path);
+
+    // All inside: the output is the input rotated by one.
+    size_t full = n / 8;
+    size_t b = 0;
+    while (b < full && mask[b] == 0xFF)
+        b++;
+    if (b == full && (n % 8 == 0 || mask[full] == (1 << (n % 8)) - 1)) {
+        outA[0] = a[n - 1];
+        outO[0] = o[n - 1];
+        memcpy(outA + 1, a, (n - 1) * sizeof(float));
+        memcpy(outO + 1, o, (n - 1) * sizeof(float));
+        return n;
+    }
+
+    auto in = [&](size_t i) -> bool { return (mask[i / 8] >> (i % 8)) & 1; };
+    size_t m = 0;
+
+    auto emit = [&](size_t i, size_t j) {
+        bool inI = in(i);
+        if (inI) {
+            outA[m] = a[i];
+            outO[m] = o[i];
+            m++;
+        }
+        if (inI != in(j)) {
+            // Same arithmetic as the intersection lambda of sutherlandHodgman.
+            float da = a[j] - a[i];
+            float dn = o[j] - o[i];
+            outA[m] = bound;
+            outO[m] = o[i] + dn * (bound - a[i]) / da;
+            m++;
+        }
+    };
+
+    emit(n - 1, 0);
+
+    // Blocks of 8 vertices [i, i + 8) with no crossing among i..i+8 are
+    // either all inside (copied) or all outside (dropped).
+    size_t i = 0;
+    for (; i + 9 <= n; i += 8) {
+        uint8_t cur = mask[i / 8];
+        bool next = in(i + 8);
+        uint8_t shifted = (uint8_t)((cur >> 1) | (next << 7));
+
+        if (cur == shifted) {
+            if (cur == 0xFF) {
+                memcpy(outA + m, a + i, 8 * sizeof(float));
+                memcpy(outO + m, o + i, 8 * sizeof(float));
+                m += 8;
+            }
+            continue;
+        }
+        for (size_t k = i; k < i + 8; k++)
+            emit(k, k + 1);
+    }
+    for (; i + 1 < n; i++)
+        emit(i, i + 1);
+
+    return m;
+}
+
+size_t clipPolygonSoA(const float* x, const float* y, size_t n, glm::vec2 pMin, glm::vec2 pMax,
+                      PolygonSoA& out, ClipBatchScratch& scratch, ClipPath path)
+{
+    ClipPath best = clipBestPath();
+    if (path == CLIP_PATH_AUTO || path > best)
+        path = best;
+
+    size_t m = n;
+    for (int edge = CLIP_LEFT; edge <= CLIP_TOP && m > 0; edge++) {
+        // A pass adds at most one vertex per two crossings: 3m/2 is enough.
+        int k = edge & 1;
+        size_t cap = m + m / 2 + 8;
+        if (scratch.x[k].size() < cap) scratch.x[k].resize(cap);
+        if (scratch.y[k].size() < cap) scratch.y[k].resize(cap);
+        if (scratch.mask.size() < m / 8 + 1) scratch.mask.resize(m / 8 + 1);
+
+        float* outX = scratch.x[k].data();
+        float* outY = scratch.y[k].data();
+        uint8_t* mask = scratch.mask.data();
+
+        switch (edge) {
+            case CLIP_LEFT:   m = clipPassSoA(x, y, m, pMin.x, true, outX, outY, mask, path); break;
+            case CLIP_RIGHT:  m = clipPassSoA(x, y, m, pMax.x, false, outX, outY, mask, path); break;
+            case CLIP_BOTTOM: m = clipPassSoA(y, x, m, pMin.y, true, outY, outX, mask, path); break;
+            case CLIP_TOP:    m = clipPassSoA(y, x, m, pMax.y, false, outY, outX, mask, path); break;
+        }
+        x = outX;
+        y = outY;
+    }
+
+    out.x.insert(out.x.end(), x, x + m);
+    out.y.insert(out.y.end(), y, y + m);
+    out.offsets.push_back((uint32_t)out.x.size());
+    return m;
+}
+
+void clipPolygonsSoA(const PolygonSoA& in, glm::vec2 pMin, glm::vec2 pMax, PolygonSoA& out,
+                     ClipBatchScratch& scratch, ClipPath path)
+{
+    if (path == CLIP_PATH_AUTO || path > clipBestPath())
+        path = clipBestPath();
+
+    out.clear();
+
+    for (size_t p = 0; p < in.size(); p++) {
+        size_t first = in.offsets[p];
+        clipPolygonSoA(in.x.data() + first, in.y.data() + first, in.offsets[p + 1] - first,
+                       pMin, pMax, out, scratch, path);
+    }
+}
@@ -0,0 +1,193 @@
+/**
+ * @file clip.h
+ * Polygon clipping against an axis-aligned rectangle (Sutherland-Hodgman).
+ */
+
+#ifndef CLIP_H
+#define CLIP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * Clips a polygon against the rectangle [pMin, pMax].
+ *
+ * Reference version: one pass per rectangle edge, each building a new
+ * vector.
+ *
+ * @param polygon Polygon vertices, in order.
+ * @param pMin Lower-left corner of the rectangle.
+ * @param pMax Upper-right corner of the rectangle.
+ * @return Clipped polygon (empty if fully outside).
+ */
+std::vector<glm::vec2> sutherlandHodgman(const std::vector<glm::vec2>& polygon, glm::vec2 pMin, glm::vec2 pMax);
+
+/**
+ * Buffers reused by the allocation-free clipper.
+ *
+ * Keep one per thread and pass it to every call: the passes ping-pong
+ * between the two vectors, which keep their capacity, so once they have
+ * grown to the largest polygon seen clipping does no heap allocation.
+ * Each pass adds at most one vertex per boundary crossing, so convex
+ * polygons never need more than n + 4 vertices.
+ */
+struct ClipScratch
+{
+    std::vector<glm::vec2> buffers[2];
+};
+
+/**
+ * Allocation-free version of sutherlandHodgman, same output.
+ *
+ * @param polygon Polygon vertices, in order.
+ * @param n Number of vertices.
+ * @param pMin Lower-left corner of the rectangle.
+ * @param pMax Upper-right corner of the rectangle.
+ * @param scratch Reusable buffers; the result lives in one of them.
+ * @return Clipped polygon, valid until the next call with the same scratch.
+ */
+const std::vector<glm::vec2>& sutherlandHodgman(const glm::vec2* polygon, size_t n, glm::vec2 pMin, glm::vec2 pMax,
+                                                ClipScratch& scratch);
+
+/**
+ * Single-pass version of sutherlandHodgman, same output.
+ *
+ * Each vertex is pushed through the four edge stages in turn, so no
+ * intermediate polygon is stored; only scratch.buffers[0] is used, for
+ * the result.
+ *
+ * @return Clipped polygon, valid until the next call with the same scratch.
+ */
+const std::vector<glm::vec2>& sutherlandHodgmanFused(const glm::vec2* polygon, size_t n, glm::vec2 pMin,
+                                                     glm::vec2 pMax, ClipScratch& scratch);
+
+/** Cohen-Sutherland outcode bits: the side of the rectangle a point is out of. */
+enum Outcode { OUT_LEFT = 1, OUT_RIGHT = 2, OUT_BOTTOM = 4, OUT_TOP = 8 };
+
+/** Outcodes of a whole polygon. */
+struct PolygonOutcodes
+{
+    /** Or of the vertex outcodes: edges some vertex is out of. */
+    unsigned any;
+    /** And of the vertex outcodes: edges every vertex is out of. */
+    unsigned all;
+};
+
+/**
+ * Outcodes of every vertex of a polygon, two vertices per SSE compare.
+ *
+ * A vertex is out of an edge exactly when sutherlandHodgman's inside test
+ * for that edge fails.
+ */
+PolygonOutcodes polygonOutcodes(const glm::vec2* polygon, size_t n, glm::vec2 pMin, glm::vec2 pMax);
+
+/** Clipped polygon that may point into the input instead of a copy. */
+struct ClipView
+{
+    const glm::vec2* points;
+    size_t size;
+};
+
+/**
+ * sutherlandHodgman with trivial accept and reject.
+ *
+ * A polygon with no vertex outside is returned as given, with no copy; one
+ * with every vertex outside the same edge is returned empty. Otherwise only
+ * the edges some vertex is outside of are clipped against. For finite
+ * coordinates the result is the same polygon as sutherlandHodgman, but may
+ * start at another vertex, since every pass of the reference rotates its
+ * input by one.
+ *
+ * @return Clipped polygon, pointing into polygon or scratch, valid until
+ *         the next call with the same scratch.
+ */
+ClipView sutherlandHodgmanTrivial(const glm::vec2* polygon, size_t n, glm::vec2 pMin, glm::vec2 pMax,
+                                  ClipScratch& scratch);
+
+/** Most points clipEdgeToRectangle writes for one edge. */
+const size_t CLIP_EDGE_MAX_POINTS = 5;
+
+/**
+ * Clips one polygon edge on its own, for incremental clipping.
+ *
+ * Writes the edge (p, q) clamped to the rectangle, without p: the points
+ * where it crosses the lines of the rectangle edges, then q, each clamped
+ * into [pMin, pMax]. Concatenating this over the edges of a polygon gives a
+ * polygon with the same winding number as the sutherlandHodgman result at
+ * every point inside the rectangle; parts outside are folded onto the
+ * border as zero-area runs. Since each edge is independent, moving or
+ * inserting a vertex only changes the output of its two edges.
+ *
+ * @param out Receives at most CLIP_EDGE_MAX_POINTS points.
+ * @return Number of points written.
+ */
+size_t clipEdgeToRectangle(glm::vec2 p, glm::vec2 q, glm::vec2 pMin, glm::vec2 pMax, glm::vec2* out);
+
+/**
+ * Many polygons in structure-of-arrays form.
+ *
+ * Polygon i has the vertices [offsets[i], offsets[i + 1]) of x and y.
+ */
+struct PolygonSoA
+{
+    std::vector<float> x, y;
+    std::vector<uint32_t> offsets = std::vector<uint32_t>(1, 0);
+
+    /** Number of polygons. */
+    size_t size() const { return offsets.size() - 1; }
+
+    /** Removes all polygons, keeping the capacity. */
+    void clear();
+
+    /** Appends a polygon. */
+    void add(const glm::vec2* points, size_t n);
+};
+
+/** Code path used for the inside tests of the batch clipper. */
+enum ClipPath { CLIP_PATH_AUTO, CLIP_PATH_SCALAR, CLIP_PATH_SSE, CLIP_PATH_AVX };
+
+/** Best path supported by the running CPU. */
+ClipPath clipBestPath();
+
+/** Human readable name of a path. */
+const char* clipPathName(ClipPath path);
+
+/** Buffers reused by clipPolygonsSoA, one per thread. */
+struct ClipBatchScratch
+{
+    std::vector<float> x[2], y[2];
+    std::vector<uint8_t> mask;
+};
+
+/**
+ * Clips one polygon given as separate x and y arrays, appending the result
+ * to out as a new polygon (possibly with no vertices).
+ *
+ * @return Number of vertices appended.
+ */
+size_t clipPolygonSoA(const float* x, const float* y, size_t n, glm::vec2 pMin, glm::vec2 pMax,
+                      PolygonSoA& out, ClipBatchScratch& scratch, ClipPath path = CLIP_PATH_AUTO);
+
+/**
+ * Clips every polygon of a batch against the rectangle [pMin, pMax].
+ *
+ * For each edge pass, inside flags for 4 (SSE) or 8 (AVX) vertices are
+ * computed at once into a bit mask. Runs of 8 vertices with no boundary
+ * crossing are then copied or dropped as a block, and only blocks with a
+ * crossing go through the per-vertex Sutherland-Hodgman rules. Output is
+ * identical to sutherlandHodgman, polygon by polygon (fully clipped
+ * polygons stay in out with no vertices).
+ *
+ * @param in Input polygons.
+ * @param pMin Lower-left corner of the rectangle.
+ * @param pMax Upper-right corner of the rectangle.
+ * @param out Clipped polygons (cleared first).
+ * @param scratch Reusable buffers.
+ * @param path Code path for the inside tests.
+ */
+void clipPolygonsSoA(const PolygonSoA& in, glm::vec2 pMin, glm::vec2 pMax, PolygonSoA& out,
+                     ClipBatchScratch& scratch, ClipPath path = CLIP_PATH_AUTO);
+
+#endif
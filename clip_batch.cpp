@@ -0,0 +1,327 @@
+/**
+ * @file clip_batch.cpp
+ * Headless batch clipping: streams polygons from a file, clips them
+ * against a rectangle or a tile grid and writes the pieces.
+ *
+ * Usage: clip_batch [-r xmin,ymin,xmax,ymax] [-g cols,rows] [-t | -b] input output
+ *
+ *   -r  Clip rectangle (default -1,-1,1,1).
+ *   -g  Split the rectangle into cols x rows tiles and clip against each.
+ *   -t  Write text; -b write binary. Default: the format of the input.
+ *
+ * The input is memory-mapped and read once, front to back; memory use
+ * depends on the largest polygon, not on the file size. It is either
+ * binary, the bytes 0x7f 'P' 'L' 'Y', a uint32 version (1) and records
+ * { uint32 n; float xy[2 * n]; }, or text with one polygon per line, as
+ * WKT or GeoJSON coordinates:
+ *
+ *   POLYGON((0 0, 1 0, 1 1, 0 0))
+ *   [[0,0],[1,0],[1,1],[0,0]]
+ *
+ * Only the first ring is read, and a last vertex equal to the first is
+ * dropped. Binary output is 0x7f 'C' 'L' 'P', a uint32 version (1) and
+ * records { uint32 source; uint32 tile; uint32 n; float xy[2 * n]; }; text
+ * output has one line "source tile POLYGON((...))" per piece. Pieces that
+ * only touch a tile (zero area) are not written. source is the
+ * index of the input polygon, tile is row * cols + col (0 without -g).
+ * Binary files are in native byte order. Output "-" is stdout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "clip.h"
+#include "tile_clip.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/** Input already read is dropped from memory in steps of this size. */
+static const size_t RELEASE_STEP = 64 << 20;
+
+/** Binary headers start with a byte no text line can start with. */
+static const char BINARY_INPUT_MAGIC[4]  = {'\x7f', 'P', 'L', 'Y'};
+static const char BINARY_OUTPUT_MAGIC[4] = {'\x7f', 'C', 'L', 'P'};
+static const uint32_t BINARY_VERSION = 1;
+
+/** Memory-mapped input, read front to back. */
+struct InputFile
+{
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    size_t released = 0;
+
+    bool open(const char* path)
+    {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return false;
+        }
+        size = st.st_size;
+        if (size > 0) {
+            void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                return false;
+            }
+            data = (const char*)p;
+            madvise(p, size, MADV_SEQUENTIAL);
+        }
+        close(fd);
+        return true;
+    }
+
+    /** Lets the kernel drop the pages before pos, which are not read again. */
+    void release()
+    {
+        if (pos - released < RELEASE_STEP) return;
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t end = pos / page * page;
+        madvise((void*)(data + released), end - released, MADV_DONTNEED);
+        released = end;
+    }
+};
+
+/**
+ * Reads the next polygon of a text file into polygon.
+ *
+ * @return False at the end of the file.
+ */
+static bool readText(InputFile& in, std::vector<glm::vec2>& polygon, std::vector<float>& coords)
+{
+    while (in.pos < in.size) {
+        const char* p = in.data + in.pos;
+        const char* end = in.data + in.size;
+        coords.clear();
+
+        bool ring = true;
+        while (p < end && *p != '\n') {
+            char c = *p;
+            if (ring && (c == '-' || c == '+' || c == '.' || (c >= '0' && c <= '9'))) {
+                float v;
+                std::from_chars_result r = std::from_chars(c == '+' ? p + 1 : p, end, v);
+                if (r.ec == std::errc()) {
+                    coords.push_back(v);
+                    p = r.ptr;
+                    continue;
+                }
+            } else if (c == ')' || (c == ']' && p + 1 < end && p[1] == ']')) {
+                // End of the first ring; holes and the rest are skipped.
+                ring = coords.empty();
+            }
+            p++;
+        }
+        in.pos = p - in.data + (p < end);
+
+        polygon.clear();
+        for (size_t i = 0; i + 1 < coords.size(); i += 2)
+            polygon.push_back(glm::vec2(coords[i], coords[i + 1]));
+        if (polygon.size() > 1 && polygon.front() == polygon.back())
+            polygon.pop_back();
+        if (!polygon.empty())
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Reads the next polygon of a binary file into polygon.
+ *
+ * @return False at the end of the file; exits on a truncated record.
+ */
+static bool readBinary(InputFile& in, std::vector<glm::vec2>& polygon)
+{
+    if (in.pos == in.size) return false;
+
+    uint32_t n;
+    if (in.size - in.pos < sizeof(n)) {
+        fprintf(stderr, "truncated record at byte %zu\n", in.pos);
+        exit(1);
+    }
+    memcpy(&n, in.data + in.pos, sizeof(n));
+    in.pos += sizeof(n);
+
+    size_t bytes = (size_t)n * sizeof(glm::vec2);
+    if (in.size - in.pos < bytes) {
+        fprintf(stderr, "truncated record at byte %zu\n", in.pos);
+        exit(1);
+    }
+    polygon.resize(n);
+    memcpy(polygon.data(), in.data + in.pos, bytes);
+    in.pos += bytes;
+    return true;
+}
+
+/** Buffered writer of clipped pieces. */
+struct OutputFile
+{
+    FILE* file = nullptr;
+    bool text = false;
+    size_t bytes = 0;
+    std::vector<char> line;
+
+    bool open(const char* path, bool asText)
+    {
+        text = asText;
+        file = strcmp(path, "-") == 0 ? stdout : fopen(path, "wb");
+        if (!file) return false;
+        setvbuf(file, NULL, _IOFBF, 1 << 20);
+        if (!text) {
+            fwrite(BINARY_OUTPUT_MAGIC, 1, sizeof(BINARY_OUTPUT_MAGIC), file);
+            fwrite(&BINARY_VERSION, sizeof(BINARY_VERSION), 1, file);
+            bytes += sizeof(BINARY_OUTPUT_MAGIC) + sizeof(BINARY_VERSION);
+        }
+        return true;
+    }
+
+    void write(uint32_t source, uint32_t tile, const glm::vec2* points, uint32_t n)
+    {
+        if (!text) {
+            uint32_t header[3] = {source, tile, n};
+            fwrite(header, sizeof(header), 1, file);
+            fwrite(points, sizeof(glm::vec2), n, file);
+            bytes += sizeof(header) + n * sizeof(glm::vec2);
+            return;
+        }
+
+        // Shortest round-trip digits; the ring is closed as WKT requires.
+        line.resize(64 + (n + 1) * 2 * 32);
+        char* p = line.data();
+        p += sprintf(p, "%u %u POLYGON((", source, tile);
+        for (uint32_t i = 0; i <= n; i++) {
+            const glm::vec2& v = points[i < n ? i : 0];
+            if (i > 0) *p++ = ',', *p++ = ' ';
+            p = std::to_chars(p, p + 32, v.x).ptr;
+            *p++ = ' ';
+            p = std::to_chars(p, p + 32, v.y).ptr;
+        }
+        *p++ = ')', *p++ = ')', *p++ = '\n';
+        fwrite(line.data(), 1, p - line.data(), file);
+        bytes += p - line.data();
+    }
+
+    bool close() { return fflush(file) == 0 && (file == stdout || fclose(file) == 0); }
+};
+
+/** True if a piece has fewer than 3 distinct vertices or no area. */
+static bool degeneratePiece(const glm::vec2* points, size_t n)
+{
+    size_t distinct = 0;
+    float area = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        const glm::vec2& a = points[i];
+        const glm::vec2& b = points[(i + 1) % n];
+        if (a != b) distinct++;
+        area += a.x * b.y - b.x * a.y;
+    }
+    return distinct < 3 || area == 0.0f;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: clip_batch [-r xmin,ymin,xmax,ymax] [-g cols,rows] [-t | -b] input output\n");
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    TileGrid grid{glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f), 1, 1};
+    int format = 0;  // 0: as input, 't' or 'b'
+    const char* paths[2];
+    int npaths = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%f,%f,%f,%f", &grid.pMin.x, &grid.pMin.y, &grid.pMax.x, &grid.pMax.y) != 4)
+                usage();
+        } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%d,%d", &grid.cols, &grid.rows) != 2 || grid.cols < 1 || grid.rows < 1)
+                usage();
+        } else if (strcmp(argv[i], "-t") == 0 || strcmp(argv[i], "-b") == 0) {
+            format = argv[i][1];
+        } else if (npaths < 2) {
+            paths[npaths++] = argv[i];
+        } else {
+            usage();
+        }
+    }
+    if (npaths != 2) usage();
+
+    InputFile in;
+    if (!in.open(paths[0])) {
+        perror(paths[0]);
+        return 1;
+    }
+    bool binary = in.size >= sizeof(BINARY_INPUT_MAGIC) &&
+                  memcmp(in.data, BINARY_INPUT_MAGIC, sizeof(BINARY_INPUT_MAGIC)) == 0;
+    if (binary) {
+        uint32_t version = 0;
+        if (in.size >= sizeof(BINARY_INPUT_MAGIC) + sizeof(version))
+            memcpy(&version, in.data + sizeof(BINARY_INPUT_MAGIC), sizeof(version));
+        if (version != BINARY_VERSION) {
+            fprintf(stderr, "%s: unsupported binary version %u\n", paths[0], version);
+            return 1;
+        }
+        in.pos = sizeof(BINARY_INPUT_MAGIC) + sizeof(version);
+    }
+
+    OutputFile out;
+    if (!out.open(paths[1], format ? format == 't' : !binary)) {
+        perror(paths[1]);
+        return 1;
+    }
+
+    std::vector<glm::vec2> polygon;
+    std::vector<float> coords;
+    ClipScratch scratch;
+    size_t polygons = 0, pieces = 0;
+
+    Clock::time_point t0 = Clock::now();
+    while (binary ? readBinary(in, polygon) : readText(in, polygon, coords)) {
+        uint32_t source = polygons++;
+        in.release();
+        if (polygon.size() < 3) continue;
+
+        glm::vec4 box(INFINITY, INFINITY, -INFINITY, -INFINITY);
+        for (const glm::vec2& p : polygon) {
+            box.x = std::min(box.x, p.x);
+            box.y = std::min(box.y, p.y);
+            box.z = std::max(box.z, p.x);
+            box.w = std::max(box.w, p.y);
+        }
+
+        int c0, c1, r0, r1;
+        if (!tileSpan(grid, box, c0, c1, r0, r1)) continue;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                glm::vec2 tMin(grid.edgeX(c), grid.edgeY(r));
+                glm::vec2 tMax(grid.edgeX(c + 1), grid.edgeY(r + 1));
+                ClipView piece = sutherlandHodgmanTrivial(polygon.data(), polygon.size(), tMin, tMax, scratch);
+                if (piece.size == 0 || degeneratePiece(piece.points, piece.size)) continue;
+                out.write(source, (uint32_t)(r * grid.cols + c), piece.points, (uint32_t)piece.size);
+                pieces++;
+            }
+        }
+    }
+    if (!out.close()) {
+        perror(paths[1]);
+        return 1;
+    }
+    double s = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    fprintf(stderr, "%zu polygons, %zu pieces in %.3f s: %.0f polygons/s, %.1f MB/s in, %.1f MB/s out\n",
+            polygons, pieces, s, polygons / s, in.size / s / 1e6, out.bytes / s / 1e6);
+    return 0;
+}
@@ -0,0 +1,325 @@
+/**
+ * @file cooked_texture.cpp
+ * Textures cooked offline: mip chains built on the CPU and stored ready
+ * for upload in a memory-mapped file.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include "cooked_texture.h"
+#include "thread_pool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COOK_X86 1
+#endif
+
+static const char COOKED_MAGIC[4] = {'T', 'E', 'X', 'C'};
+
+/** Alignment of each level in the file. */
+static const uint64_t LEVEL_ALIGNMENT = 64;
+
+/** Source samples and weights of one destination sample along an axis. */
+struct Taps
+{
+    uint32_t first;
+    int count;
+    float weight[3];
+};
+
+/** Taps of a 2:1 reduction of n samples: box for even n, polyphase box for odd n. */
+static std::vector<Taps> reductionTaps(uint32_t n)
+{
+    uint32_t m = std::max(n / 2, 1u);
+    std::vector<Taps> taps(m);
+    for (uint32_t i = 0; i < m; i++) {
+        if (n == 1)
+            taps[i] = Taps{0, 1, {1.0f, 0.0f, 0.0f}};
+        else if (n % 2 == 0)
+            taps[i] = Taps{2 * i, 2, {0.5f, 0.5f, 0.0f}};
+        else
+            taps[i] = Taps{2 * i, 3, {(float)(m - i) / n, (float)m / n, (float)(i + 1) / n}};
+    }
+    return taps;
+}
+
+static float srgbToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static bool isAlpha(uint32_t channel, uint32_t channels)
+{
+    return (channels == 2 && channel == 1) || (channels == 4 && channel == 3);
+}
+
+/** Rows [y0, y1) of an even-by-even level: exact 2x2 average, rounded to nearest. */
+static void boxRowsScalar(const uint8_t* src, uint32_t srcWidth, uint32_t channels, uint8_t* dst, uint32_t y0,
+                          uint32_t y1)
+{
+    size_t srcStride = (size_t)srcWidth * channels;
+    size_t dstStride = srcStride / 2;
+    for (uint32_t y = y0; y < y1; y++) {
+        const uint8_t* a = src + 2 * y * srcStride;
+        const uint8_t* b = a + srcStride;
+        uint8_t* out = dst + y * dstStride;
+        for (size_t x = 0; x < dstStride; x++) {
+            size_t i = (x / channels) * 2 * channels + x % channels;
+            out[x] = (uint8_t)((a[i] + a[i + channels] + b[i] + b[i + channels] + 2) >> 2);
+        }
+    }
+}
+
+#ifdef COOK_X86
+/**
+ * SSE2 version of boxRowsScalar: rows are summed 16 bytes at a time in
+ * 16 bits, then adjacent pixels are added, in registers for 4 channels
+ * and from the summed row otherwise.
+ */
+static void boxRowsSSE2(const uint8_t* src, uint32_t srcWidth, uint32_t channels, uint8_t* dst, uint32_t y0,
+                        uint32_t y1)
+{
+    size_t srcStride = (size_t)srcWidth * channels;
+    size_t dstStride = srcStride / 2;
+    std::vector<uint16_t> sum(srcStride + 16);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+
+    for (uint32_t y = y0; y < y1; y++) {
+        const uint8_t* a = src + 2 * y * srcStride;
+        const uint8_t* b = a + srcStride;
+        uint8_t* out = dst + y * dstStride;
+
+        size_t i = 0;
+        for (; i + 16 <= srcStride; i += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+            __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+            __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+            _mm_storeu_si128((__m128i*)(sum.data() + i), lo);
+            _mm_storeu_si128((__m128i*)(sum.data() + i + 8), hi);
+        }
+        for (; i < srcStride; i++)
+            sum[i] = a[i] + b[i];
+
+        size_t x = 0;
+        if (channels == 4) {
+            // Two output pixels from four summed ones.
+            for (; x + 8 <= dstStride; x += 8) {
+                __m128i p01 = _mm_loadu_si128((const __m128i*)(sum.data() + 2 * x));
+                __m128i p23 = _mm_loadu_si128((const __m128i*)(sum.data() + 2 * x + 8));
+                __m128i q0 = _mm_add_epi16(p01, _mm_srli_si128(p01, 8));
+                __m128i q1 = _mm_add_epi16(p23, _mm_srli_si128(p23, 8));
+                __m128i q = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(q0, q1), two), 2);
+                _mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(q, q));
+            }
+        }
+        for (; x < dstStride; x++) {
+            size_t s = (x / channels) * 2 * channels + x % channels;
+            out[x] = (uint8_t)((sum[s] + sum[s + channels] + 2) >> 2);
+        }
+    }
+}
+#endif
+
+/**
+ * Rows [y0, y1) of any level, through float: the vertical taps are summed
+ * into a row, then the horizontal taps, optionally in linear light.
+ */
+static void filterRows(const uint8_t* src, uint32_t srcWidth, uint32_t channels, const std::vector<Taps>& tapsX,
+                       const std::vector<Taps>& tapsY, bool linearLight, uint8_t* dst, uint32_t y0, uint32_t y1)
+{
+    float decode[2][256];
+    for (int v = 0; v < 256; v++) {
+        decode[0][v] = (float)v;
+        decode[1][v] = linearLight ? srgbToLinear(v / 255.0f) : (float)v;
+    }
+
+    size_t srcStride = (size_t)srcWidth * channels;
+    size_t dstStride = tapsX.size() * channels;
+    std::vector<float> row(srcStride);
+
+    for (uint32_t y = y0; y < y1; y++) {
+        const Taps& ty = tapsY[y];
+        std::fill(row.begin(), row.end(), 0.0f);
+        for (int j = 0; j < ty.count; j++) {
+            const uint8_t* s = src + (ty.first + j) * srcStride;
+            for (size_t i = 0; i < srcStride; i++)
+                row[i] += ty.weight[j] * decode[!isAlpha(i % channels, channels)][s[i]];
+        }
+
+        uint8_t* out = dst + y * dstStride;
+        for (size_t x = 0; x < tapsX.size(); x++) {
+            const Taps& tx = tapsX[x];
+            for (uint32_t c = 0; c < channels; c++) {
+                float v = 0.0f;
+                for (int k = 0; k < tx.count; k++)
+                    v += tx.weight[k] * row[(tx.first + k) * channels + c];
+                if (linearLight && !isAlpha(c, channels))
+                    v = linearToSrgb(v) * 255.0f;
+                out[x * channels + c] = (uint8_t)std::min(std::max(std::lround(v), 0L), 255L);
+            }
+        }
+    }
+}
+
+void buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, bool linearLight,
+                   ThreadPool* pool, MipChain& chain)
+{
+    chain.width = width;
+    chain.height = height;
+    chain.channels = channels;
+    chain.levels.clear();
+
+    uint64_t total = 0;
+    for (uint32_t w = width, h = height;; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u)) {
+        uint64_t size = (uint64_t)w * h * channels;
+        chain.levels.push_back(CookedLevel{w, h, total, size});
+        total += size;
+        if (w == 1 && h == 1) break;
+    }
+    chain.pixels.resize(total);
+    memcpy(chain.pixels.data(), pixels, chain.levels[0].size);
+
+#ifdef COOK_X86
+    bool sse2 = __builtin_cpu_supports("sse2");
+#endif
+    for (size_t l = 1; l < chain.levels.size(); l++) {
+        const CookedLevel& from = chain.levels[l - 1];
+        const CookedLevel& to = chain.levels[l];
+        const uint8_t* src = chain.pixels.data() + from.offset;
+        uint8_t* dst = chain.pixels.data() + to.offset;
+
+        bool box = !linearLight && from.width % 2 == 0 && from.height % 2 == 0;
+        std::vector<Taps> tapsX, tapsY;
+        if (!box) {
+            tapsX = reductionTaps(from.width);
+            tapsY = reductionTaps(from.height);
+        }
+
+        auto rows = [&](uint32_t y0, uint32_t y1) {
+            if (!box)
+                filterRows(src, from.width, channels, tapsX, tapsY, linearLight, dst, y0, y1);
+#ifdef COOK_X86
+            else if (sse2)
+                boxRowsSSE2(src, from.width, channels, dst, y0, y1);
+#endif
+            else
+                boxRowsScalar(src, from.width, channels, dst, y0, y1);
+        };
+
+        // Small levels are not worth waking the pool for.
+        uint32_t chunks = pool ? std::min(pool->size() * 4, to.height / 8) : 0;
+        if (chunks <= 1) {
+            rows(0, to.height);
+        } else {
+            pool->parallelFor(chunks, [&](size_t i) {
+                rows((uint32_t)((uint64_t)to.height * i / chunks), (uint32_t)((uint64_t)to.height * (i + 1) / chunks));
+            });
+        }
+    }
+}
+
+bool writeCookedTexture(const char* path, const MipChain& chain)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+
+    CookedHeader header;
+    memcpy(header.magic, COOKED_MAGIC, sizeof(header.magic));
+    header.version = COOKED_TEXTURE_VERSION;
+    header.width = chain.width;
+    header.height = chain.height;
+    header.channels = chain.channels;
+    header.levels = (uint32_t)chain.levels.size();
+
+    std::vector<CookedLevel> table = chain.levels;
+    uint64_t offset = sizeof(CookedHeader) + table.size() * sizeof(CookedLevel);
+    for (CookedLevel& level : table) {
+        offset = (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+        level.offset = offset;
+        offset += level.size;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(table.data(), sizeof(CookedLevel), table.size(), f) == table.size();
+    uint64_t written = sizeof(CookedHeader) + table.size() * sizeof(CookedLevel);
+
+    const char padding[LEVEL_ALIGNMENT] = {0};
+    for (size_t l = 0; ok && l < table.size(); l++) {
+        size_t pad = (size_t)(table[l].offset - written);
+        ok = fwrite(padding, 1, pad, f) == pad &&
+             fwrite(chain.pixels.data() + chain.levels[l].offset, 1, table[l].size, f) == table[l].size;
+        written = table[l].offset + table[l].size;
+    }
+    return fclose(f) == 0 && ok;
+}
+
+bool CookedTexture::open(const char* path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CookedHeader)) {
+        fprintf(stderr, "%s: not a cooked texture\n", path);
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+    data = (const uint8_t*)p;
+    size = st.st_size;
+
+    const CookedHeader& h = header();
+    const char* problem = NULL;
+    if (memcmp(h.magic, COOKED_MAGIC, sizeof(h.magic)) != 0)
+        problem = "not a cooked texture";
+    else if (h.version != COOKED_TEXTURE_VERSION)
+        problem = "unsupported version, cook it again";
+    else if (h.channels < 1 || h.channels > 4 || h.levels < 1 || h.levels > 32 ||
+             size < sizeof(CookedHeader) + h.levels * sizeof(CookedLevel))
+        problem = "corrupt header";
+
+    for (uint32_t i = 0; !problem && i < h.levels; i++) {
+        const CookedLevel& l = level(i);
+        uint32_t w = std::max(h.width >> i, 1u), hh = std::max(h.height >> i, 1u);
+        if (l.width != w || l.height != hh || l.size != (uint64_t)w * hh * h.channels ||
+            l.offset > size || l.size > size - l.offset)
+            problem = "corrupt level table";
+    }
+    if (problem) {
+        fprintf(stderr, "%s: %s\n", path, problem);
+        close();
+        return false;
+    }
+
+    madvise(p, size, MADV_WILLNEED);
+    return true;
+}
+
+void CookedTexture::close()
+{
+    if (data) munmap((void*)data, size);
+    data = nullptr;
+    size = 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file cooked_texture.h
+ * Textures cooked offline: mip chains built on the CPU and stored ready
+ * for upload in a memory-mapped file.
+ */
+
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+/** Version written by writeCookedTexture; other versions are rejected. */
+const uint32_t COOKED_TEXTURE_VERSION = 1;
+
+/**
+ * File layout, native byte order:
+ *
+ *   CookedHeader
+ *   CookedLevel[levels]      level 0 first
+ *   pixels of each level     rows tightly packed, each level 64-byte aligned
+ */
+struct CookedHeader
+{
+    char magic[4];        /**< "TEXC" */
+    uint32_t version;
+    uint32_t width, height;
+    uint32_t channels;    /**< 1 to 4, 8 bits each. */
+    uint32_t levels;
+};
+
+/** One mip level; offset is from the start of the file. */
+struct CookedLevel
+{
+    uint32_t width, height;
+    uint64_t offset, size;
+};
+
+/** A full mip chain in memory, level 0 first; offsets are into pixels. */
+struct MipChain
+{
+    uint32_t width = 0, height = 0, channels = 0;
+    std::vector<CookedLevel> levels;
+    std::vector<uint8_t> pixels;
+};
+
+/**
+ * Builds every level down to 1x1 from 8-bit pixels.
+ *
+ * Each level halves the one above (rounding down). Even sizes use the 2x2
+ * box, rounded to nearest as glGenerateMipmap usually does; odd sizes use
+ * the 3-tap polyphase box, so no source row or column is dropped. With
+ * linearLight, color channels are averaged after sRGB decoding and
+ * encoded again, which keeps bright detail from darkening; alpha (the
+ * 2nd or 4th channel) is always averaged as is.
+ *
+ * @param pool Splits each level by rows; NULL runs on the caller.
+ */
+void buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, bool linearLight,
+                   ThreadPool* pool, MipChain& chain);
+
+/** Writes a chain in the cooked format. */
+bool writeCookedTexture(const char* path, const MipChain& chain);
+
+/**
+ * Cooked file, memory-mapped read-only: levels are read straight from
+ * the page cache with no decoding or copy.
+ */
+class CookedTexture
+{
+public:
+    CookedTexture() {}
+    ~CookedTexture() { close(); }
+
+    CookedTexture(const CookedTexture&) = delete;
+    CookedTexture& operator=(const CookedTexture&) = delete;
+
+    /**
+     * Maps a file and checks its header and level table.
+     *
+     * @return False, with a message on stderr, if it is not a cooked
+     *         texture of this version or is truncated.
+     */
+    bool open(const char* path);
+
+    /** Unmaps the file. */
+    void close();
+
+    const CookedHeader& header() const { return *(const CookedHeader*)data; }
+    const CookedLevel& level(uint32_t i) const { return ((const CookedLevel*)(data + sizeof(CookedHeader)))[i]; }
+    const uint8_t* levelPixels(uint32_t i) const { return data + level(i).offset; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+#endif
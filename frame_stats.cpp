@@ -0,0 +1,133 @@
+/**
+ * @file frame_stats.cpp
+ * Opt-in per-frame timing: CPU time, GL time (timer queries) and counts.
+ */
+
+#include <stdio.h>
+#include <GL/glew.h>
+#include "frame_stats.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double msBetween(Clock::time_point a, Clock::time_point b)
+{
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+FrameStats::FrameStats(size_t capacity) : ring(capacity > 0 ? capacity : 1)
+{
+}
+
+FrameSample& FrameStats::sample(unsigned long frame)
+{
+    return ring[frame % ring.size()];
+}
+
+void FrameStats::collectQuery(int slot, bool wait)
+{
+    if (!queryPending[slot]) return;
+
+    if (!wait) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+    }
+
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &ns);
+    queryPending[slot] = false;
+
+    // The sample may already have been overwritten by a newer frame.
+    unsigned long f = queryFrame[slot];
+    if (frames - f <= ring.size())
+        sample(f).gpuMs = ns * 1e-6;
+}
+
+void FrameStats::beginFrame()
+{
+    if (queries[0] == 0)
+        glGenQueries(QUERIES, queries);
+
+    int slot = frames % QUERIES;
+    for (int i = 0; i < QUERIES; i++)
+        collectQuery(i, i == slot);
+
+    frameStart = Clock::now();
+    queryFrame[slot] = frames;
+    glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+}
+
+void FrameStats::endFrame(size_t points)
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    queryPending[frames % QUERIES] = true;
+
+    Clock::time_point now = Clock::now();
+    FrameSample& s = sample(frames);
+    s.frame = frames;
+    s.frameMs = frames > 0 ? msBetween(lastStart, frameStart) : 0.0;
+    s.cpuMs = msBetween(frameStart, now);
+    s.gpuMs = -1.0;
+    s.points = points;
+
+    lastStart = frameStart;
+    frames++;
+}
+
+void FrameStats::finish()
+{
+    if (queries[0] == 0) return;
+
+    for (int i = 0; i < QUERIES; i++)
+        collectQuery(i, true);
+    glDeleteQueries(QUERIES, queries);
+    for (int i = 0; i < QUERIES; i++)
+        queries[i] = 0;
+}
+
+size_t FrameStats::size() const
+{
+    return frames < ring.size() ? frames : ring.size();
+}
+
+FrameSample FrameStats::mean(size_t n) const
+{
+    FrameSample m = {frames, 0.0, 0.0, 0.0, 0};
+    size_t used = 0;
+
+    for (size_t i = 0; i < size() && used < n; i++) {
+        const FrameSample& s = ring[(frames - 1 - i) % ring.size()];
+        if (s.gpuMs < 0.0) continue;
+        m.frameMs += s.frameMs;
+        m.cpuMs += s.cpuMs;
+        m.gpuMs += s.gpuMs;
+        m.points += s.points;
+        used++;
+    }
+
+    if (used > 0) {
+        m.frameMs /= used;
+        m.cpuMs /= used;
+        m.gpuMs /= used;
+        m.points /= used;
+    }
+    return m;
+}
+
+bool FrameStats::writeCSV(const char* path) const
+{
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+
+    fprintf(f, "frame,frame_ms,cpu_ms,gpu_ms,points\n");
+    for (unsigned long i = frames - size(); i < frames; i++) {
+        const FrameSample& s = ring[i % ring.size()];
+        fprintf(f, "%lu,%.4f,%.4f,%.4f,%zu\n", s.frame, s.frameMs, s.cpuMs, s.gpuMs, s.points);
+    }
+
+    fclose(f);
+    return true;
+}
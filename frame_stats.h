@@ -0,0 +1,76 @@
+/**
+ * @file frame_stats.h
+ * Opt-in per-frame timing: CPU time, GL time (timer queries) and counts.
+ */
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+/** Measurements of one frame. GL time is -1 until its query resolves. */
+struct FrameSample
+{
+    unsigned long frame;
+    double frameMs;   /**< Time since the previous frame started. */
+    double cpuMs;     /**< Time between beginFrame and endFrame. */
+    double gpuMs;     /**< GL_TIME_ELAPSED of the frame's commands. */
+    size_t points;    /**< Primitives drawn, as reported by the caller. */
+};
+
+/**
+ * Ring buffer of frame samples.
+ *
+ * GL timer queries are read back a few frames late so the CPU never waits
+ * for the GPU. Requires a current GL context for beginFrame/endFrame.
+ */
+class FrameStats
+{
+public:
+    explicit FrameStats(size_t capacity = 4096);
+
+    /** Marks the start of a frame. */
+    void beginFrame();
+
+    /** Marks the end of a frame (call before swapping buffers). */
+    void endFrame(size_t points);
+
+    /**
+     * Waits for pending GL queries and releases them.
+     *
+     * Call while the context is still current, e.g. right after
+     * glutMainLoop returns, so every way out of the loop is covered.
+     */
+    void finish();
+
+    /** Mean of the last n samples with a resolved GL time. */
+    FrameSample mean(size_t n) const;
+
+    /** Number of frames recorded so far. */
+    unsigned long frameCount() const { return frames; }
+
+    /** Number of samples kept (at most the capacity). */
+    size_t size() const;
+
+    /** Writes the kept samples, oldest first, as CSV. */
+    bool writeCSV(const char* path) const;
+
+private:
+    static const int QUERIES = 4;
+
+    FrameSample& sample(unsigned long frame);
+    void collectQuery(int slot, bool wait);
+
+    std::vector<FrameSample> ring;
+    unsigned long frames = 0;
+    std::chrono::steady_clock::time_point frameStart;
+    std::chrono::steady_clock::time_point lastStart;
+
+    unsigned int queries[QUERIES] = {0};
+    unsigned long queryFrame[QUERIES];
+    bool queryPending[QUERIES] = {false};
+};
+
+#endif
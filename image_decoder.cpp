@@ -0,0 +1,103 @@
+/**
+ * @file image_decoder.cpp
+ * Image files decoded by stb_image on background threads.
+ */
+
+#include "stb_image.h"
+#include "image_decoder.h"
+
+void freeImage(DecodedImage& image)
+{
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+}
+
+ImageDecoder::ImageDecoder(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    for (unsigned i = 0; i < threads; i++)
+        workers.emplace_back(&ImageDecoder::workerLoop, this);
+}
+
+ImageDecoder::~ImageDecoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    wake.notify_all();
+    for (std::thread& t : workers)
+        t.join();
+
+    for (DecodedImage& image : results)
+        freeImage(image);
+}
+
+void ImageDecoder::push(size_t id, const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(Job{id, path});
+    }
+    wake.notify_one();
+}
+
+bool ImageDecoder::poll(DecodedImage& image)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (results.empty()) return false;
+    image = results.front();
+    results.pop_front();
+    return true;
+}
+
+bool ImageDecoder::wait(DecodedImage& image)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return !results.empty() || (jobs.empty() && decoding == 0); });
+    if (results.empty()) return false;
+    image = results.front();
+    results.pop_front();
+    return true;
+}
+
+size_t ImageDecoder::outstanding() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size() + decoding + results.size();
+}
+
+void ImageDecoder::workerLoop()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            decoding++;
+        }
+
+        // stbi_load keeps no shared state, so threads decode independently.
+        DecodedImage image = {job.id, 0, 0, 0, nullptr};
+        image.pixels = stbi_load(job.path.c_str(), &image.width, &image.height, &image.channels, 0);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decoding--;
+            if (stopping) {
+                freeImage(image);
+                return;
+            }
+            results.push_back(image);
+        }
+        finished.notify_all();
+    }
+}
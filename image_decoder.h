@@ -0,0 +1,81 @@
+/**
+ * @file image_decoder.h
+ * Image files decoded by stb_image on background threads.
+ */
+
+#ifndef IMAGE_DECODER_H
+#define IMAGE_DECODER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** A decoded image, or a failed one (pixels == nullptr). */
+struct DecodedImage
+{
+    size_t id;
+    int width, height, channels;
+    unsigned char* pixels;  /**< From stbi_load; release with freeImage. */
+};
+
+/** Releases the pixels of an image. */
+void freeImage(DecodedImage& image);
+
+/**
+ * Fixed set of threads that decode queued files in order of submission.
+ *
+ * Files are queued and results collected from one thread; the results
+ * come out as they finish, which with several threads is not necessarily
+ * the queue order. The destructor drops files not started yet, waits for
+ * those being decoded and frees every result not collected.
+ */
+class ImageDecoder
+{
+public:
+    /** @param threads Decoding threads; 0 uses std::thread::hardware_concurrency(). */
+    explicit ImageDecoder(unsigned threads = 0);
+    ~ImageDecoder();
+
+    ImageDecoder(const ImageDecoder&) = delete;
+    ImageDecoder& operator=(const ImageDecoder&) = delete;
+
+    /** Number of decoding threads. */
+    unsigned size() const { return (unsigned)workers.size(); }
+
+    /** Queues a file; its result will carry id. */
+    void push(size_t id, const std::string& path);
+
+    /** Takes a finished image, if any. */
+    bool poll(DecodedImage& image);
+
+    /** Waits for a finished image; false if nothing is queued or decoding. */
+    bool wait(DecodedImage& image);
+
+    /** Files queued or being decoded, plus results not collected. */
+    size_t outstanding() const;
+
+private:
+    struct Job
+    {
+        size_t id;
+        std::string path;
+    };
+
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    std::deque<Job> jobs;
+    std::deque<DecodedImage> results;
+    size_t decoding = 0;
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,277 @@
+/**
+ * @file instances.cpp
+ * Per-instance transforms of many spinning cubes, updated every frame.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include "instances.h"
+#include "thread_pool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INSTANCES_X86 1
+#endif
+
+/** Cubes per task of the parallel update. */
+static const size_t UPDATE_BLOCK = 4096;
+
+void makeCubeField(size_t n, float extent, float tiltRadians, CubeField& field)
+{
+    size_t side = (size_t)std::ceil(std::cbrt((double)n));
+    while (side * side * side < n) side++;
+    float cell = extent / (float)std::max<size_t>(side, 1);
+
+    field.x.resize(n);
+    field.y.resize(n);
+    field.z.resize(n);
+    field.phase.resize(n);
+    field.speed.resize(n);
+    field.scale = 0.6f * cell;
+    field.tiltSin = std::sin(tiltRadians);
+    field.tiltCos = std::cos(tiltRadians);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> phase(0.0f, 6.2831853f), speed(0.5f, 2.0f);
+    for (size_t i = 0; i < n; i++) {
+        field.x[i] = -0.5f * extent + cell * (i % side + 0.5f);
+        field.y[i] = -0.5f * extent + cell * (i / side % side + 0.5f);
+        field.z[i] = -0.5f * extent + cell * (i / (side * side) + 0.5f);
+        field.phase[i] = phase(rng);
+        field.speed[i] = speed(rng);
+    }
+}
+
+/*
+ * The model matrix of a cube is translate(x, y, z) * Rx(tilt) * Ry(angle)
+ * * scale. With s = sin(angle), c = cos(angle) its rows are
+ *
+ *   ( k c,        0,        k s,        x )
+ *   ( k sin(t) s, k cos(t), -k sin(t) c, y )
+ *   (-k cos(t) s, k sin(t), k cos(t) c,  z )
+ *
+ * for scale k and tilt t, so only four products change per frame.
+ */
+
+static void updateScalar(const CubeField& f, float time, float* rows, size_t begin, size_t end)
+{
+    const float k = f.scale, kts = k * f.tiltSin, ktc = k * f.tiltCos;
+    for (size_t i = begin; i < end; i++) {
+        float angle = f.phase[i] + f.speed[i] * time;
+        float s = sinf(angle), c = cosf(angle);
+        float* r = rows + i * INSTANCE_FLOATS;
+        r[0] = k * c;     r[1] = 0.0f; r[2]  = k * s;      r[3]  = f.x[i];
+        r[4] = kts * s;   r[5] = ktc;  r[6]  = -(kts * c); r[7]  = f.y[i];
+        r[8] = -(ktc * s); r[9] = kts; r[10] = ktc * c;    r[11] = f.z[i];
+    }
+}
+
+#ifdef INSTANCES_X86
+
+/*
+ * sin and cos of the vector paths: the angle is reduced to [-pi/4, pi/4]
+ * around the nearest multiple q of pi/2, with pi/2 split in three parts so
+ * the reduction stays exact for large q, then evaluated with the minimax
+ * polynomials of Cephes' sinf and cosf. Bit 0 of q swaps the two results,
+ * bit 1 of q (of q + 1 for the cosine) flips the sign.
+ */
+static const float PIO2_1 = 1.5703125f;
+static const float PIO2_2 = 4.837512969970703125e-4f;
+static const float PIO2_3 = 7.54978995489188216e-8f;
+static const float TWO_OVER_PI = 0.636619772367581f;
+static const float SIN_P0 = -1.9515295891e-4f, SIN_P1 = 8.3321608736e-3f, SIN_P2 = -1.6666654611e-1f;
+static const float COS_P0 = 2.443315711809948e-5f, COS_P1 = -1.388731625493765e-3f, COS_P2 = 4.166664568298827e-2f;
+
+static inline void sincosSSE2(__m128 a, __m128& sinOut, __m128& cosOut)
+{
+    __m128i q = _mm_cvtps_epi32(_mm_mul_ps(a, _mm_set1_ps(TWO_OVER_PI)));
+    __m128 qf = _mm_cvtepi32_ps(q);
+    __m128 r = _mm_sub_ps(a, _mm_mul_ps(qf, _mm_set1_ps(PIO2_1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(PIO2_2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(PIO2_3)));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), r2), _mm_set1_ps(SIN_P1));
+    ps = _mm_add_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(SIN_P2));
+    ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, r2), r), r);
+
+    __m128 pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), r2), _mm_set1_ps(COS_P1));
+    pc = _mm_add_ps(_mm_mul_ps(pc, r2), _mm_set1_ps(COS_P2));
+    pc = _mm_mul_ps(_mm_mul_ps(pc, r2), r2);
+    pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_set1_ps(1.0f));
+
+    const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+
+    sinOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps)), sinSign);
+    cosOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc)), cosSign);
+}
+
+/** Writes rows a..d (one value of 4 cubes each) as 4 floats of each cube. */
+static inline void storeTransposed(float* out, __m128 a, __m128 b, __m128 c, __m128 d)
+{
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(out, a);
+    _mm_storeu_ps(out + INSTANCE_FLOATS, b);
+    _mm_storeu_ps(out + 2 * INSTANCE_FLOATS, c);
+    _mm_storeu_ps(out + 3 * INSTANCE_FLOATS, d);
+}
+
+static void updateSSE2(const CubeField& f, float time, float* rows, size_t begin, size_t end)
+{
+    const __m128 k = _mm_set1_ps(f.scale), t = _mm_set1_ps(time);
+    const __m128 kts = _mm_set1_ps(f.scale * f.tiltSin), ktc = _mm_set1_ps(f.scale * f.tiltCos);
+    const __m128 zero = _mm_setzero_ps(), negate = _mm_set1_ps(-0.0f);
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 angle = _mm_add_ps(_mm_loadu_ps(&f.phase[i]), _mm_mul_ps(_mm_loadu_ps(&f.speed[i]), t));
+        __m128 s, c;
+        sincosSSE2(angle, s, c);
+
+        float* out = rows + i * INSTANCE_FLOATS;
+        storeTransposed(out, _mm_mul_ps(k, c), zero, _mm_mul_ps(k, s), _mm_loadu_ps(&f.x[i]));
+        storeTransposed(out + 4, _mm_mul_ps(kts, s), ktc, _mm_xor_ps(_mm_mul_ps(kts, c), negate),
+                        _mm_loadu_ps(&f.y[i]));
+        storeTransposed(out + 8, _mm_xor_ps(_mm_mul_ps(ktc, s), negate), kts, _mm_mul_ps(ktc, c),
+                        _mm_loadu_ps(&f.z[i]));
+    }
+    updateScalar(f, time, rows, i, end);
+}
+
+/** 8-wide sincosSSE2. */
+__attribute__((target("avx2")))
+static inline void sincosAVX2(__m256 a, __m256& sinOut, __m256& cosOut)
+{
+    __m256i q = _mm256_cvtps_epi32(_mm256_mul_ps(a, _mm256_set1_ps(TWO_OVER_PI)));
+    __m256 qf = _mm256_cvtepi32_ps(q);
+    __m256 r = _mm256_sub_ps(a, _mm256_mul_ps(qf, _mm256_set1_ps(PIO2_1)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(PIO2_2)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(PIO2_3)));
+    __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 ps = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_P0), r2), _mm256_set1_ps(SIN_P1));
+    ps = _mm256_add_ps(_mm256_mul_ps(ps, r2), _mm256_set1_ps(SIN_P2));
+    ps = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ps, r2), r), r);
+
+    __m256 pc = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS_P0), r2), _mm256_set1_ps(COS_P1));
+    pc = _mm256_add_ps(_mm256_mul_ps(pc, r2), _mm256_set1_ps(COS_P2));
+    pc = _mm256_mul_ps(_mm256_mul_ps(pc, r2), r2);
+    pc = _mm256_add_ps(_mm256_sub_ps(pc, _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)), _mm256_set1_ps(1.0f));
+
+    const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+    __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30));
+    __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, one), two), 30));
+
+    sinOut = _mm256_xor_ps(_mm256_blendv_ps(ps, pc, swap), sinSign);
+    cosOut = _mm256_xor_ps(_mm256_blendv_ps(pc, ps, swap), cosSign);
+}
+
+/**
+ * storeTransposed for 8 cubes: the in-lane transpose leaves cubes 0-3 in
+ * the low halves and cubes 4-7 in the high halves.
+ */
+__attribute__((target("avx2")))
+static inline void storeTransposed8(float* out, __m256 a, __m256 b, __m256 c, __m256 d)
+{
+    __m256 ab0 = _mm256_unpacklo_ps(a, b), ab1 = _mm256_unpackhi_ps(a, b);
+    __m256 cd0 = _mm256_unpacklo_ps(c, d), cd1 = _mm256_unpackhi_ps(c, d);
+    __m256 t[4] = {
+        _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(3, 2, 3, 2)),
+        _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(3, 2, 3, 2)),
+    };
+    for (int j = 0; j < 4; j++) {
+        _mm_storeu_ps(out + j * INSTANCE_FLOATS, _mm256_castps256_ps128(t[j]));
+        _mm_storeu_ps(out + (j + 4) * INSTANCE_FLOATS, _mm256_extractf128_ps(t[j], 1));
+    }
+}
+
+__attribute__((target("avx2")))
+static void updateAVX2(const CubeField& f, float time, float* rows, size_t begin, size_t end)
+{
+    const __m256 k = _mm256_set1_ps(f.scale), t = _mm256_set1_ps(time);
+    const __m256 kts = _mm256_set1_ps(f.scale * f.tiltSin), ktc = _mm256_set1_ps(f.scale * f.tiltCos);
+    const __m256 zero = _mm256_setzero_ps(), negate = _mm256_set1_ps(-0.0f);
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 angle = _mm256_add_ps(_mm256_loadu_ps(&f.phase[i]),
+                                     _mm256_mul_ps(_mm256_loadu_ps(&f.speed[i]), t));
+        __m256 s, c;
+        sincosAVX2(angle, s, c);
+
+        float* out = rows + i * INSTANCE_FLOATS;
+        storeTransposed8(out, _mm256_mul_ps(k, c), zero, _mm256_mul_ps(k, s), _mm256_loadu_ps(&f.x[i]));
+        storeTransposed8(out + 4, _mm256_mul_ps(kts, s), ktc, _mm256_xor_ps(_mm256_mul_ps(kts, c), negate),
+                         _mm256_loadu_ps(&f.y[i]));
+        storeTransposed8(out + 8, _mm256_xor_ps(_mm256_mul_ps(ktc, s), negate), kts, _mm256_mul_ps(ktc, c),
+                         _mm256_loadu_ps(&f.z[i]));
+    }
+    updateSSE2(f, time, rows, i, end);
+}
+
+#endif
+
+InstancePath instanceBestPath()
+{
+#ifdef INSTANCES_X86
+    if (__builtin_cpu_supports("avx2")) return INSTANCE_AVX2;
+    if (__builtin_cpu_supports("sse2")) return INSTANCE_SSE2;
+#endif
+    return INSTANCE_SCALAR;
+}
+
+const char* instancePathName(InstancePath path)
+{
+    switch (path) {
+        case INSTANCE_AUTO:   return "auto";
+        case INSTANCE_SCALAR: return "scalar";
+        case INSTANCE_SSE2:   return "sse2";
+        case INSTANCE_AVX2:   return "avx2";
+    }
+    return "?";
+}
+
+/** The requested path, or the best one if the CPU lacks it. */
+static InstancePath resolvePath(InstancePath path)
+{
+    InstancePath best = instanceBestPath();
+    return path == INSTANCE_AUTO || path > best ? best : path;
+}
+
+void updateInstances(const CubeField& field, float time, float* rows, size_t begin, size_t end, InstancePath path)
+{
+    switch (resolvePath(path)) {
+#ifdef INSTANCES_X86
+        case INSTANCE_AVX2:
+            updateAVX2(field, time, rows, begin, end);
+            break;
+        case INSTANCE_SSE2:
+            updateSSE2(field, time, rows, begin, end);
+            break;
+#endif
+        default:
+            updateScalar(field, time, rows, begin, end);
+    }
+}
+
+void updateInstances(const CubeField& field, float time, float* rows, ThreadPool& pool, InstancePath path)
+{
+    path = resolvePath(path);
+    size_t n = field.size();
+    if (n <= UPDATE_BLOCK || pool.size() == 1) {
+        updateInstances(field, time, rows, 0, n, path);
+        return;
+    }
+    pool.parallelFor((n + UPDATE_BLOCK - 1) / UPDATE_BLOCK, [&](size_t block) {
+        size_t begin = block * UPDATE_BLOCK;
+        updateInstances(field, time, rows, begin, std::min(begin + UPDATE_BLOCK, n), path);
+    });
+}
@@ -0,0 +1,76 @@
+/**
+ * @file instances.h
+ * Per-instance transforms of many spinning cubes, updated every frame.
+ */
+
+#ifndef INSTANCES_H
+#define INSTANCES_H
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+/**
+ * Animation of each cube, structure of arrays so the update can load
+ * several cubes per instruction.
+ *
+ * Cube i sits at (x, y, z), tilted by a fixed angle about x, and spins
+ * about y by phase + speed * time radians.
+ */
+struct CubeField
+{
+    std::vector<float> x, y, z;
+    std::vector<float> phase, speed;
+    float scale = 1.0f;
+    float tiltSin = 0.0f, tiltCos = 1.0f;
+
+    size_t size() const { return x.size(); }
+};
+
+/**
+ * Fills a cube of side extent centered on the origin with n cubes on a
+ * regular grid, random phases and speeds of 0.5 to 2 rad/s. Each cube
+ * takes 0.6 of its grid cell.
+ */
+void makeCubeField(size_t n, float extent, float tiltRadians, CubeField& field);
+
+/**
+ * Floats per instance: the top three rows of the model matrix, row-major
+ * (rotation and scale in xyz, translation in w), read by the shader as
+ * three vec4 attributes.
+ */
+const size_t INSTANCE_FLOATS = 12;
+
+/** Code path of the update. */
+enum InstancePath { INSTANCE_AUTO, INSTANCE_SCALAR, INSTANCE_SSE2, INSTANCE_AVX2 };
+
+/** Best path supported by the running CPU. */
+InstancePath instanceBestPath();
+
+/** Human readable name of a path. */
+const char* instancePathName(InstancePath path);
+
+/**
+ * Writes the rows of cubes [begin, end) at the given time.
+ *
+ * The vector paths evaluate sin and cos with a polynomial (error below
+ * 1e-6 for angles of a few thousand radians) and write 4 or 8 cubes per
+ * iteration; the scalar path uses sinf and cosf. Paths the CPU does not
+ * support fall back to the best available one.
+ *
+ * @param rows INSTANCE_FLOATS * field.size() floats; only the rows of
+ *        [begin, end) are written. Need not be aligned.
+ */
+void updateInstances(const CubeField& field, float time, float* rows, size_t begin, size_t end,
+                     InstancePath path = INSTANCE_AUTO);
+
+/**
+ * Parallel version over the whole field. Each task writes a contiguous
+ * block of cubes, so threads never share a cache line of the output
+ * except at block edges.
+ */
+void updateInstances(const CubeField& field, float time, float* rows, ThreadPool& pool,
+                     InstancePath path = INSTANCE_AUTO);
+
+#endif
@@ -0,0 +1,228 @@
+/**
+ * @file mesh.cpp
+ * Triangle meshes: de-duplication into indexed form and packed vertex
+ * formats.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include "mesh.h"
+
+MeshFormat floatMeshFormat()
+{
+    MeshFormat f;
+    f.normal = ATTR_FLOAT;
+    f.uv = ATTR_FLOAT;
+    f.normalOffset = offsetof(MeshVertex, normal);
+    f.uvOffset = offsetof(MeshVertex, uv);
+    f.stride = sizeof(MeshVertex);
+    return f;
+}
+
+MeshFormat chooseMeshFormat(const MeshVertex* vertices, size_t n)
+{
+    float normalLength2 = 0.0f, uvMin = 0.0f, uvMax = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        const MeshVertex& v = vertices[i];
+        normalLength2 = std::max(normalLength2, glm::dot(v.normal, v.normal));
+        uvMin = std::min(uvMin, std::min(v.uv.x, v.uv.y));
+        uvMax = std::max(uvMax, std::max(v.uv.x, v.uv.y));
+    }
+
+    MeshFormat f;
+    // A little slack for normals normalized in float.
+    f.normal = normalLength2 <= 1.0001f ? ATTR_SNORM_10_10_10_2 : ATTR_FLOAT;
+    if (uvMin >= 0.0f && uvMax <= 1.0f)
+        f.uv = ATTR_UNORM16;
+    else if (uvMin >= -2.0f && uvMax <= 2.0f)
+        f.uv = ATTR_HALF;
+    else
+        f.uv = ATTR_FLOAT;
+
+    f.normalOffset = sizeof(glm::vec3);
+    f.uvOffset = f.normalOffset + (f.normal == ATTR_FLOAT ? sizeof(glm::vec3) : sizeof(uint32_t));
+    f.stride = f.uvOffset + (f.uv == ATTR_FLOAT ? sizeof(glm::vec2) : 2 * sizeof(uint16_t));
+    return f;
+}
+
+uint16_t packHalf(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint16_t sign = (x >> 16) & 0x8000;
+    uint32_t a = x & 0x7fffffff;
+
+    if (a >= 0x7f800000)  // infinity, or NaN kept quiet
+        return sign | 0x7c00 | (a > 0x7f800000 ? 0x200 : 0);
+    if (a >= 0x477ff000)  // 65520 and up round to infinity
+        return sign | 0x7c00;
+    if (a < 0x38800000) {
+        // Subnormal: multiples of 2^-24, exact in float, rounded to even.
+        float m;
+        memcpy(&m, &a, sizeof(m));
+        return sign | (uint16_t)std::nearbyint(m * 16777216.0f);
+    }
+
+    // Rebias the exponent from 127 to 15 and drop 13 mantissa bits; a
+    // carry out of the mantissa correctly bumps the exponent.
+    uint32_t h = (a - 0x38000000) >> 13;
+    uint32_t rest = a & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+        h++;
+    return sign | (uint16_t)h;
+}
+
+float unpackHalf(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+
+    if (exponent == 0) {
+        float m = std::ldexp((float)mantissa, -24);
+        return sign ? -m : m;
+    }
+    uint32_t x = exponent == 31 ? sign | 0x7f800000 | (mantissa << 13)
+                                : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+uint32_t packSnorm10(glm::vec3 v)
+{
+    auto component = [](float c) {
+        int i = (int)std::lround(std::min(std::max(c, -1.0f), 1.0f) * 511.0f);
+        return (uint32_t)i & 0x3ff;
+    };
+    return component(v.x) | component(v.y) << 10 | component(v.z) << 20;
+}
+
+glm::vec3 unpackSnorm10(uint32_t p)
+{
+    // Sign-extend each field; -512 and -511 both mean -1 (GL 4.2 rule).
+    auto component = [](uint32_t bits) {
+        int i = (int)(bits << 22) >> 22;
+        return std::max(i / 511.0f, -1.0f);
+    };
+    return glm::vec3(component(p & 0x3ff), component(p >> 10 & 0x3ff), component(p >> 20 & 0x3ff));
+}
+
+/** Hash and equality of the bytes of a vertex. */
+struct VertexBytes
+{
+    size_t operator()(const MeshVertex& v) const
+    {
+        uint32_t words[sizeof(MeshVertex) / 4];
+        memcpy(words, &v, sizeof(words));
+        uint64_t h = 1469598103934665603ULL;
+        for (uint32_t w : words)
+            h = (h ^ w) * 1099511628211ULL;
+        return (size_t)(h ^ h >> 32);
+    }
+
+    bool operator()(const MeshVertex& a, const MeshVertex& b) const
+    {
+        return memcmp(&a, &b, sizeof(MeshVertex)) == 0;
+    }
+};
+
+void indexMesh(const MeshVertex* vertices, size_t n, std::vector<MeshVertex>& unique,
+               std::vector<uint32_t>& indices)
+{
+    std::unordered_map<MeshVertex, uint32_t, VertexBytes, VertexBytes> seen;
+    seen.reserve(n);
+    unique.clear();
+    indices.resize(n);
+
+    for (size_t i = 0; i < n; i++) {
+        auto it = seen.emplace(vertices[i], (uint32_t)unique.size());
+        if (it.second)
+            unique.push_back(vertices[i]);
+        indices[i] = it.first->second;
+    }
+}
+
+void packVertices(const MeshVertex* vertices, size_t n, const MeshFormat& format, std::vector<uint8_t>& out)
+{
+    out.resize(n * format.stride);
+    uint8_t* dst = out.data();
+
+    for (size_t i = 0; i < n; i++, dst += format.stride) {
+        const MeshVertex& v = vertices[i];
+        memcpy(dst, &v.position, sizeof(glm::vec3));
+
+        if (format.normal == ATTR_SNORM_10_10_10_2) {
+            uint32_t p = packSnorm10(v.normal);
+            memcpy(dst + format.normalOffset, &p, sizeof(p));
+        } else {
+            memcpy(dst + format.normalOffset, &v.normal, sizeof(glm::vec3));
+        }
+
+        uint16_t uv[2];
+        switch (format.uv) {
+            case ATTR_UNORM16:
+                uv[0] = (uint16_t)std::lround(v.uv.x * 65535.0f);
+                uv[1] = (uint16_t)std::lround(v.uv.y * 65535.0f);
+                memcpy(dst + format.uvOffset, uv, sizeof(uv));
+                break;
+            case ATTR_HALF:
+                uv[0] = packHalf(v.uv.x);
+                uv[1] = packHalf(v.uv.y);
+                memcpy(dst + format.uvOffset, uv, sizeof(uv));
+                break;
+            default:
+                memcpy(dst + format.uvOffset, &v.uv, sizeof(glm::vec2));
+        }
+    }
+}
+
+std::vector<MeshVertex> sphereTriangles(int slices, int stacks)
+{
+    const float pi = 3.14159265358979f;
+
+    // Computed from the grid indices alone, so shared corners come out
+    // bit-identical and indexMesh can merge them.
+    auto vertex = [&](int s, int t) {
+        float theta = pi * t / stacks, phi = 2.0f * pi * s / slices;
+        glm::vec3 p(std::sin(theta) * std::sin(phi), std::cos(theta), std::sin(theta) * std::cos(phi));
+        return MeshVertex{p, p, glm::vec2((float)s / slices, 1.0f - (float)t / stacks)};
+    };
+
+    std::vector<MeshVertex> v;
+    v.reserve((size_t)slices * stacks * 6);
+    for (int t = 0; t < stacks; t++) {
+        for (int s = 0; s < slices; s++) {
+            // Counter-clockwise seen from outside; the pole rows have one
+            // triangle per quad.
+            if (t > 0) {
+                v.push_back(vertex(s, t));
+                v.push_back(vertex(s, t + 1));
+                v.push_back(vertex(s + 1, t));
+            }
+            if (t < stacks - 1) {
+                v.push_back(vertex(s + 1, t));
+                v.push_back(vertex(s, t + 1));
+                v.push_back(vertex(s + 1, t + 1));
+            }
+        }
+    }
+    return v;
+}
+
+double averageCacheMissRatio(const uint32_t* indices, size_t n, size_t cacheSize)
+{
+    std::vector<uint32_t> cache(cacheSize, UINT32_MAX);
+    size_t next = 0, misses = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (std::find(cache.begin(), cache.end(), indices[i]) != cache.end())
+            continue;
+        cache[next] = indices[i];
+        next = (next + 1) % cacheSize;
+        misses++;
+    }
+    return n >= 3 ? misses / (double)(n / 3) : 0.0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file mesh.h
+ * Triangle meshes: de-duplication into indexed form and packed vertex
+ * formats.
+ */
+
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/** Vertex as authored, in full float precision. */
+struct MeshVertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+/** How one attribute is stored in a packed vertex. */
+enum AttributeFormat
+{
+    ATTR_FLOAT,        /**< 32-bit float per component. */
+    ATTR_HALF,         /**< 16-bit float per component. */
+    ATTR_UNORM16,      /**< 16-bit unsigned, normalized to [0, 1]. */
+    ATTR_SNORM_10_10_10_2  /**< Three signed 10-bit components normalized to [-1, 1], in 32 bits. */
+};
+
+/**
+ * Layout of a packed vertex: the position stays float, normal and UV use
+ * the format picked for them. Offsets and stride are in bytes.
+ */
+struct MeshFormat
+{
+    AttributeFormat normal;
+    AttributeFormat uv;
+    size_t normalOffset, uvOffset, stride;
+};
+
+/** Layout with every attribute as float, as MeshVertex itself. */
+MeshFormat floatMeshFormat();
+
+/**
+ * Smallest format that keeps the attributes of the given vertices.
+ *
+ * Normals no longer than 1 go to 10:10:10:2 (about 0.001 per component).
+ * UVs in [0, 1] go to normalized 16-bit integers, those within [-2, 2] to
+ * half floats, which keep 1/1024 there; others stay float.
+ */
+MeshFormat chooseMeshFormat(const MeshVertex* vertices, size_t n);
+
+/** Nearest half float to f (rounded to nearest even, saturating to infinity). */
+uint16_t packHalf(float f);
+
+/** Value of a half float. */
+float unpackHalf(uint16_t h);
+
+/** v, with components in [-1, 1], as GL_INT_2_10_10_10_REV with w = 0. */
+uint32_t packSnorm10(glm::vec3 v);
+
+/** Value of a packSnorm10 word, as GL normalizes it. */
+glm::vec3 unpackSnorm10(uint32_t p);
+
+/**
+ * Merges equal vertices of a triangle list.
+ *
+ * Vertices are equal if all their bytes are, so only exact copies are
+ * merged. The unique vertices keep the order of their first use, which
+ * keeps neighbouring triangles close in memory.
+ *
+ * @param vertices Triangle list, 3 vertices per triangle.
+ * @param n Number of vertices.
+ * @param unique Receives the distinct vertices.
+ * @param indices Receives n indices into unique.
+ */
+void indexMesh(const MeshVertex* vertices, size_t n, std::vector<MeshVertex>& unique,
+               std::vector<uint32_t>& indices);
+
+/**
+ * Writes vertices in a packed format.
+ *
+ * @param out Receives n * format.stride bytes.
+ */
+void packVertices(const MeshVertex* vertices, size_t n, const MeshFormat& format, std::vector<uint8_t>& out);
+
+/**
+ * Unit sphere as a triangle list with no shared vertices, like an
+ * exported mesh before indexing.
+ *
+ * @param slices Divisions around the axis.
+ * @param stacks Divisions from pole to pole.
+ */
+std::vector<MeshVertex> sphereTriangles(int slices, int stacks);
+
+/**
+ * Vertex shader runs for an index list with a FIFO post-transform cache,
+ * per triangle: 3 without reuse, down to about 0.5 for a regular grid.
+ */
+double averageCacheMissRatio(const uint32_t* indices, size_t n, size_t cacheSize);
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file mesh_buffer.cpp
+ * Static triangle mesh on the GPU, indexed and packed.
+ */
+
+#include <GL/glew.h>
+#include "mesh_buffer.h"
+
+void MeshBuffer::upload(const MeshVertex* data, size_t n, bool compact)
+{
+    if (VAO == 0) {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+    }
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+    if (!compact) {
+        format = floatMeshFormat();
+        vertices = n;
+        indices = indexSize = 0;
+        glBufferData(GL_ARRAY_BUFFER, n * sizeof(MeshVertex), data, GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
+    } else {
+        std::vector<MeshVertex> unique;
+        std::vector<uint32_t> index;
+        indexMesh(data, n, unique, index);
+
+        format = chooseMeshFormat(unique.data(), unique.size());
+        std::vector<uint8_t> packed;
+        packVertices(unique.data(), unique.size(), format, packed);
+        vertices = unique.size();
+        glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+
+        indices = index.size();
+        if (vertices <= 65536) {
+            std::vector<uint16_t> index16(index.begin(), index.end());
+            indexSize = sizeof(uint16_t);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, index16.size() * indexSize, index16.data(), GL_STATIC_DRAW);
+        } else {
+            indexSize = sizeof(uint32_t);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, index.size() * indexSize, index.data(), GL_STATIC_DRAW);
+        }
+    }
+
+    GLsizei stride = (GLsizei)format.stride;
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glEnableVertexAttribArray(0);
+
+    if (format.normal == ATTR_SNORM_10_10_10_2)
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)format.normalOffset);
+    else
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)format.normalOffset);
+    glEnableVertexAttribArray(1);
+
+    switch (format.uv) {
+        case ATTR_UNORM16:
+            glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)format.uvOffset);
+            break;
+        case ATTR_HALF:
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)format.uvOffset);
+            break;
+        default:
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)format.uvOffset);
+    }
+    glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+}
+
+void MeshBuffer::draw() const
+{
+    glBindVertexArray(VAO);
+    if (indexSize == 0)
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices);
+    else
+        glDrawElements(GL_TRIANGLES, (GLsizei)indices,
+                       indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)0);
+}
+
+void MeshBuffer::instanceAttributes(unsigned int buffer, unsigned int first, unsigned int count)
+{
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    GLsizei stride = (GLsizei)(count * 4 * sizeof(float));
+    for (unsigned int i = 0; i < count; i++) {
+        glVertexAttribPointer(first + i, 4, GL_FLOAT, GL_FALSE, stride, (void*)(i * 4 * sizeof(float)));
+        glEnableVertexAttribArray(first + i);
+        glVertexAttribDivisor(first + i, 1);
+    }
+    glBindVertexArray(0);
+}
+
+void MeshBuffer::drawInstanced(size_t instances) const
+{
+    glBindVertexArray(VAO);
+    if (indexSize == 0)
+        glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei)vertices, (GLsizei)instances);
+    else
+        glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)indices,
+                                indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)0,
+                                (GLsizei)instances);
+}
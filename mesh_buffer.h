@@ -0,0 +1,70 @@
+/**
+ * @file mesh_buffer.h
+ * Static triangle mesh on the GPU, indexed and packed.
+ */
+
+#ifndef MESH_BUFFER_H
+#define MESH_BUFFER_H
+
+#include <cstddef>
+#include "mesh.h"
+
+/**
+ * Vertex array of a MeshVertex triangle list with position at location 0,
+ * normal at 1 and UV at 2, as the shaders expect.
+ *
+ * By default the triangle list is indexed (see indexMesh) and packed with
+ * chooseMeshFormat; the shaders see the same float attributes either way.
+ * Indices are 16-bit when there are at most 65536 unique vertices.
+ * Uploading needs a current context.
+ */
+class MeshBuffer
+{
+public:
+    MeshBuffer() {}
+    MeshBuffer(const MeshBuffer&) = delete;
+    MeshBuffer& operator=(const MeshBuffer&) = delete;
+
+    /**
+     * Replaces the mesh.
+     *
+     * @param vertices Triangle list, 3 vertices per triangle.
+     * @param n Number of vertices.
+     * @param compact False to upload the list as given, all float, and
+     *        draw it without indices.
+     */
+    void upload(const MeshVertex* vertices, size_t n, bool compact = true);
+
+    /** Draws the triangles; the program and textures must be bound. */
+    void draw() const;
+
+    /**
+     * Reads count per-instance vec4 attributes, at locations first to
+     * first + count - 1, tightly packed in buffer. Call after upload.
+     */
+    void instanceAttributes(unsigned int buffer, unsigned int first, unsigned int count);
+
+    /** Draws the mesh instances times with one call. */
+    void drawInstanced(size_t instances) const;
+
+    /** Vertices stored. */
+    size_t vertexCount() const { return vertices; }
+
+    /** Bytes of vertex data. */
+    size_t vertexBytes() const { return vertices * format.stride; }
+
+    /** Bytes of index data (0 if not indexed). */
+    size_t indexBytes() const { return indices * indexSize; }
+
+    /** Layout of the stored vertices. */
+    const MeshFormat& vertexFormat() const { return format; }
+
+private:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    MeshFormat format = floatMeshFormat();
+    size_t vertices = 0, indices = 0;
+    /** Bytes per index, 0 if not indexed. */
+    size_t indexSize = 0;
+};
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * @file precise_clip.cpp
+ * Sutherland-Hodgman clipping with a selectable scalar type, for
+ * coordinates that need more than float precision.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "precise_clip.h"
+
+FixedPoint toFixed(glm::dvec2 p)
+{
+    const double scale = (double)(1LL << FIXED_FRACTION_BITS);
+    return FixedPoint((int64_t)std::llround(p.x * scale), (int64_t)std::llround(p.y * scale));
+}
+
+glm::dvec2 fromFixed(FixedPoint p)
+{
+    const double scale = 1.0 / (double)(1LL << FIXED_FRACTION_BITS);
+    return glm::dvec2(p.x * scale, p.y * scale);
+}
+
+/**
+ * True if (a2, b2) is nearer to the line a = bound; ties go to the smaller
+ * point, so both directions of an edge start from the same endpoint.
+ */
+template <typename T>
+static inline bool startFromSecond(T a1, T b1, T a2, T b2, T bound)
+{
+    T d1 = std::abs(bound - a1), d2 = std::abs(a2 - bound);
+    if (d1 != d2) return d2 < d1;
+    return a2 < a1 || (a2 == a1 && b2 < b1);
+}
+
+/**
+ * Where the edge (a1, b1) - (a2, b2) meets the line a = bound, as the b
+ * coordinate. The endpoints are on opposite sides of the line, or one is
+ * on it.
+ */
+template <typename T>
+static inline T crossing(T a1, T b1, T a2, T b2, T bound)
+{
+    // From the nearer endpoint the parameter is at most 1/2, and clamping
+    // keeps the result between b1 and b2 however small a2 - a1 is.
+    if (startFromSecond(a1, b1, a2, b2, bound)) {
+        std::swap(a1, a2);
+        std::swap(b1, b2);
+    }
+    T da = a2 - a1;
+    if (da == 0) return b1;
+    T t = std::min(std::max((bound - a1) / da, T(0)), T(1));
+    return b1 + (b2 - b1) * t;
+}
+
+template <>
+inline int64_t crossing<int64_t>(int64_t a1, int64_t b1, int64_t a2, int64_t b2, int64_t bound)
+{
+    if (startFromSecond(a1, b1, a2, b2, bound)) {
+        std::swap(a1, a2);
+        std::swap(b1, b2);
+    }
+    int64_t da = a2 - a1;
+    if (da == 0) return b1;
+
+    // (b2 - b1) * (bound - a1) / da, exact product, rounded to nearest.
+    __int128 num = (__int128)(b2 - b1) * (bound - a1);
+    if (da < 0) {
+        num = -num;
+        da = -da;
+    }
+    __int128 half = da / 2;
+    __int128 q = num >= 0 ? (num + half) / da : -((-num + half) / da);
+    return b1 + (int64_t)q;
+}
+
+enum PreciseEdge { PRECISE_LEFT, PRECISE_RIGHT, PRECISE_BOTTOM, PRECISE_TOP };
+
+/**
+ * One pass, with the inside tests of sutherlandHodgman.
+ *
+ * Each edge of the clipped polygon either lies on an input edge or runs
+ * along the rectangle border between two crossings. Crossings of the
+ * first kind are computed from the input edge, not from the clipped
+ * piece of it; those of the second kind are corners.
+ */
+template <PreciseEdge edge, typename T>
+static void precisePass(const TaggedPoint<T>* input, size_t n, const glm::vec<2, T>* polygon, size_t m,
+                        glm::vec<2, T> pMin, glm::vec<2, T> pMax, std::vector<TaggedPoint<T>>& output)
+{
+    typedef glm::vec<2, T> Point;
+
+    auto inside = [&](const Point& p) {
+        switch (edge) {
+            case PRECISE_LEFT:   return p.x >= pMin.x;
+            case PRECISE_RIGHT:  return p.x <= pMax.x;
+            case PRECISE_BOTTOM: return p.y >= pMin.y;
+            case PRECISE_TOP:    return p.y <= pMax.y;
+        }
+        return false;
+    };
+    auto intersect = [&](const TaggedPoint<T>& S, const TaggedPoint<T>& E) {
+        bool vertical = edge == PRECISE_LEFT || edge == PRECISE_RIGHT;
+        T bound = edge == PRECISE_LEFT ? pMin.x : edge == PRECISE_RIGHT ? pMax.x
+                : edge == PRECISE_BOTTOM ? pMin.y : pMax.y;
+
+        // Along a border line crossing this one: the corner.
+        if (vertical) {
+            if (S.p.y == E.p.y && (S.p.y == pMin.y || S.p.y == pMax.y))
+                return TaggedPoint<T>{Point(bound, S.p.y), S.edge};
+        } else {
+            if (S.p.x == E.p.x && (S.p.x == pMin.x || S.p.x == pMax.x))
+                return TaggedPoint<T>{Point(S.p.x, bound), S.edge};
+        }
+
+        const Point& p1 = polygon[S.edge];
+        const Point& p2 = polygon[S.edge + 1 == m ? 0 : S.edge + 1];
+        if (vertical)
+            return TaggedPoint<T>{Point(bound, crossing(p1.x, p1.y, p2.x, p2.y, bound)), S.edge};
+        return TaggedPoint<T>{Point(crossing(p1.y, p1.x, p2.y, p2.x, bound), bound), S.edge};
+    };
+
+    output.clear();
+    if (n == 0) return;
+
+    TaggedPoint<T> S = input[n - 1];
+    bool inS = inside(S.p);
+    for (size_t i = 0; i < n; i++) {
+        const TaggedPoint<T>& E = input[i];
+        bool inE = inside(E.p);
+
+        if (inS)
+            output.push_back(S);
+        if (inS != inE)
+            output.push_back(intersect(S, E));
+
+        S = E;
+        inS = inE;
+    }
+}
+
+template <typename T>
+const std::vector<glm::vec<2, T>>& sutherlandHodgmanPrecise(const glm::vec<2, T>* polygon, size_t n,
+                                                            glm::vec<2, T> pMin, glm::vec<2, T> pMax,
+                                                            PreciseClipScratch<T>& scratch)
+{
+    std::vector<TaggedPoint<T>>& a = scratch.tagged[0];
+    std::vector<TaggedPoint<T>>& b = scratch.tagged[1];
+    a.reserve(n + 4);
+    b.reserve(n + 4);
+
+    b.clear();
+    for (size_t i = 0; i < n; i++)
+        b.push_back(TaggedPoint<T>{polygon[i], (uint32_t)i});
+
+    precisePass<PRECISE_LEFT>(b.data(), b.size(), polygon, n, pMin, pMax, a);
+    precisePass<PRECISE_RIGHT>(a.data(), a.size(), polygon, n, pMin, pMax, b);
+    precisePass<PRECISE_BOTTOM>(b.data(), b.size(), polygon, n, pMin, pMax, a);
+    precisePass<PRECISE_TOP>(a.data(), a.size(), polygon, n, pMin, pMax, b);
+
+    scratch.result.clear();
+    for (const TaggedPoint<T>& t : b)
+        scratch.result.push_back(t.p);
+    return scratch.result;
+}
+
+template const std::vector<glm::vec<2, float>>& sutherlandHodgmanPrecise(
+    const glm::vec<2, float>*, size_t, glm::vec<2, float>, glm::vec<2, float>, PreciseClipScratch<float>&);
+template const std::vector<glm::vec<2, double>>& sutherlandHodgmanPrecise(
+    const glm::vec<2, double>*, size_t, glm::vec<2, double>, glm::vec<2, double>, PreciseClipScratch<double>&);
+template const std::vector<glm::vec<2, int64_t>>& sutherlandHodgmanPrecise(
+    const glm::vec<2, int64_t>*, size_t, glm::vec<2, int64_t>, glm::vec<2, int64_t>, PreciseClipScratch<int64_t>&);
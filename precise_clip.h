@@ -0,0 +1,70 @@
+/**
+ * @file precise_clip.h
+ * Sutherland-Hodgman clipping with a selectable scalar type, for
+ * coordinates that need more than float precision.
+ */
+
+#ifndef PRECISE_CLIP_H
+#define PRECISE_CLIP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/** Fractional bits of the fixed-point coordinates. */
+const int FIXED_FRACTION_BITS = 20;
+
+/** Point in fixed point: each coordinate is value * 2^FIXED_FRACTION_BITS. */
+typedef glm::vec<2, int64_t> FixedPoint;
+
+/** Rounds a point to fixed point. */
+FixedPoint toFixed(glm::dvec2 p);
+
+/** Value of a fixed-point point. */
+glm::dvec2 fromFixed(FixedPoint p);
+
+/** A vertex and the input edge its outgoing edge lies on, unless on the border. */
+template <typename T>
+struct TaggedPoint
+{
+    glm::vec<2, T> p;
+    uint32_t edge;
+};
+
+/** Buffers reused by sutherlandHodgmanPrecise, one per thread. */
+template <typename T>
+struct PreciseClipScratch
+{
+    /** Passes ping-pong here: vertices and the input edge each one starts. */
+    std::vector<TaggedPoint<T>> tagged[2];
+    std::vector<glm::vec<2, T>> result;
+};
+
+/**
+ * Clips a polygon against the rectangle [pMin, pMax], computing in T:
+ * float, double or int64_t (fixed point, see toFixed).
+ *
+ * Inside tests are the same as sutherlandHodgman's, but rounding does not
+ * pile up over the passes: every crossing is computed once, from the input
+ * edge it lies on rather than from a piece already clipped by earlier
+ * passes, and crossings along the border are the exact corners. The
+ * crossing is interpolated from the endpoint nearer to the rectangle edge
+ * with the parameter clamped, so a nearly parallel edge cannot throw it
+ * outside the edge, and both directions of an edge give the same point.
+ * In fixed point it is rounded to nearest from an exact 128-bit product;
+ * coordinates must stay below 2^62 in magnitude.
+ *
+ * @param polygon Polygon vertices, in order.
+ * @param n Number of vertices.
+ * @param pMin Lower-left corner of the rectangle.
+ * @param pMax Upper-right corner of the rectangle.
+ * @param scratch Reusable buffers; the result lives in one of them.
+ * @return Clipped polygon, valid until the next call with the same scratch.
+ */
+template <typename T>
+const std::vector<glm::vec<2, T>>& sutherlandHodgmanPrecise(const glm::vec<2, T>* polygon, size_t n,
+                                                            glm::vec<2, T> pMin, glm::vec<2, T> pMax,
+                                                            PreciseClipScratch<T>& scratch);
+
+#endif
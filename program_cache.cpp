@@ -0,0 +1,65 @@
+/**
+ * @file program_cache.cpp
+ * Shader program with uniform locations resolved once and cached values.
+ */
+
+#include <string.h>
+#include <GL/glew.h>
+#include <glm/gtc/type_ptr.hpp>
+#include "program_cache.h"
+
+/** Program made current by the last ProgramCache::use(). */
+static int currentProgram = 0;
+
+void ProgramCache::init(int prog, std::initializer_list<const char*> names)
+{
+    program = prog;
+    slots.clear();
+    for (const char* name : names) {
+        Slot s;
+        s.location = glGetUniformLocation(program, name);
+        s.valid = false;
+        slots.push_back(s);
+    }
+}
+
+void ProgramCache::use()
+{
+    if (currentProgram == program) return;
+    glUseProgram(program);
+    currentProgram = program;
+}
+
+bool ProgramCache::changed(Slot& s, const float* v, size_t n)
+{
+    if (s.location < 0) return false;
+    if (s.valid && memcmp(s.value, v, n * sizeof(float)) == 0) return false;
+
+    memcpy(s.value, v, n * sizeof(float));
+    s.valid = true;
+    return true;
+}
+
+void ProgramCache::setMat4(size_t slot, const glm::mat4& m)
+{
+    if (changed(slots[slot], glm::value_ptr(m), 16))
+        glUniformMatrix4fv(slots[slot].location, 1, GL_FALSE, glm::value_ptr(m));
+}
+
+void ProgramCache::setVec3(size_t slot, const glm::vec3& v)
+{
+    if (changed(slots[slot], &v.x, 3))
+        glUniform3fv(slots[slot].location, 1, &v.x);
+}
+
+void ProgramCache::setVec2(size_t slot, const glm::vec2& v)
+{
+    if (changed(slots[slot], &v.x, 2))
+        glUniform2fv(slots[slot].location, 1, &v.x);
+}
+
+void ProgramCache::invalidate()
+{
+    for (Slot& s : slots)
+        s.valid = false;
+}
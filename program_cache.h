@@ -0,0 +1,68 @@
+/**
+ * @file program_cache.h
+ * Shader program with uniform locations resolved once and cached values.
+ */
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <initializer_list>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * Wraps a program created by createShaderProgram.
+ *
+ * Uniforms are addressed by the index of their name in init(), usually
+ * through an enum in the program. Setters remember the last uploaded value
+ * and skip the GL call when it did not change, so display functions can
+ * set everything every frame and only real changes reach the driver.
+ * Setters upload to the current program, so call use() first.
+ */
+class ProgramCache
+{
+public:
+    /**
+     * Resolves the uniform locations of a program.
+     *
+     * @param program Program returned by createShaderProgram.
+     * @param names Uniform names, in slot order.
+     */
+    void init(int program, std::initializer_list<const char*> names);
+
+    /** Program handle. */
+    int id() const { return program; }
+
+    /** Location of a slot (-1 if the uniform is unused by the shader). */
+    int location(size_t slot) const { return slots[slot].location; }
+
+    /** Makes the program current, unless it already is. */
+    void use();
+
+    /** Uploads a matrix if it differs from the last uploaded value. */
+    void setMat4(size_t slot, const glm::mat4& m);
+
+    /** Uploads a vector if it differs from the last uploaded value. */
+    void setVec3(size_t slot, const glm::vec3& v);
+
+    /** Uploads a vector if it differs from the last uploaded value. */
+    void setVec2(size_t slot, const glm::vec2& v);
+
+    /** Forgets cached values, forcing the next setters to upload. */
+    void invalidate();
+
+private:
+    struct Slot
+    {
+        int location;
+        bool valid;
+        float value[16];
+    };
+
+    bool changed(Slot& s, const float* v, size_t n);
+
+    int program = 0;
+    std::vector<Slot> slots;
+};
+
+#endif
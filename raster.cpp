@@ -0,0 +1,613 @@
+/**
+ * @file raster.cpp
+ * Bresenham circle rasterization shared by the demos and benchmarks.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "raster.h"
+#include "thread_pool.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RASTER_X86 1
+#endif
+
+void bresenhamCircle(int xc, int yc, int r, std::vector<glm::vec3>& out)
+{
+    int x = 0, y = r;
+    int d = 3 - 2 * r;
+
+    auto plotCirclePoints = [&](int x, int y) {
+        out.push_back(glm::vec3(xc + x, yc + y, 0.0f));
+        out.push_back(glm::vec3(xc - x, yc + y, 0.0f));
+        out.push_back(glm::vec3(xc + x, yc - y, 0.0f));
+        out.push_back(glm::vec3(xc - x, yc - y, 0.0f));
+        out.push_back(glm::vec3(xc + y, yc + x, 0.0f));
+        out.push_back(glm::vec3(xc - y, yc + x, 0.0f));
+        out.push_back(glm::vec3(xc + y, yc - x, 0.0f));
+        out.push_back(glm::vec3(xc - y, yc - x, 0.0f));
+    };
+
+    while (x <= y) {
+        plotCirclePoints(x, y);
+        if (d < 0)
+            d = d + 4 * x + 6;
+        else {
+            d = d + 4 * (x - y) + 10;
+            y--;
+        }
+        x++;
+    }
+}
+
+/** Integer square root (floor). */
+static int64_t isqrt(int64_t n)
+{
+    if (n <= 0) return 0;
+    int64_t s = (int64_t)std::sqrt((double)n);
+    while (s * s > n) s--;
+    while ((s + 1) * (s + 1) <= n) s++;
+    return s;
+}
+
+/**
+ * y chosen by the Bresenham loop at column x.
+ *
+ * The decision variable is d = 2(x+1)^2 + y^2 + (y-1)^2 - 2r^2, so the loop
+ * keeps the largest y with x^2 + y(y-1) < r^2, i.e. (2y-1)^2 <= 4(r^2-x^2).
+ */
+static int bresenhamY(int x, int r)
+{
+    if (x == 0) return r;
+    int64_t m = 4 * ((int64_t)r * r - (int64_t)x * x);
+    if (m <= 0) return 0;
+    return (int)((isqrt(m) + 1) / 2);
+}
+
+size_t bresenhamOctantSteps(int r)
+{
+    if (r < 0) return 0;
+
+    // Last x with x <= y(x); y(x) is non-increasing so this is a binary search.
+    int lo = 0, hi = r;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (mid <= bresenhamY(mid, r))
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return (size_t)lo + 1;
+}
+
+size_t bresenhamCirclePointCount(int r)
+{
+    return 8 * bresenhamOctantSteps(r);
+}
+
+size_t bresenhamCirclesPointCount(const Circle* circles, size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+        total += bresenhamCirclePointCount(circles[i].r);
+    return total;
+}
+
+size_t bresenhamCircles(const Circle* circles, size_t count, glm::vec3* out)
+{
+    glm::vec3* p = out;
+
+    for (size_t i = 0; i < count; i++) {
+        const int xc = circles[i].xc, yc = circles[i].yc;
+        int x = 0, y = circles[i].r;
+        int d = 3 - 2 * y;
+
+        while (x <= y) {
+            p[0] = glm::vec3(xc + x, yc + y, 0.0f);
+            p[1] = glm::vec3(xc - x, yc + y, 0.0f);
+            p[2] = glm::vec3(xc + x, yc - y, 0.0f);
+            p[3] = glm::vec3(xc - x, yc - y, 0.0f);
+            p[4] = glm::vec3(xc + y, yc + x, 0.0f);
+            p[5] = glm::vec3(xc - y, yc + x, 0.0f);
+            p[6] = glm::vec3(xc + y, yc - x, 0.0f);
+            p[7] = glm::vec3(xc - y, yc - x, 0.0f);
+            p += 8;
+
+            if (d < 0)
+                d = d + 4 * x + 6;
+            else {
+                d = d + 4 * (x - y) + 10;
+                y--;
+            }
+            x++;
+        }
+    }
+
+    return (size_t)(p - out);
+}
+
+bool circlesFitInt16(const Circle* circles, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const Circle& c = circles[i];
+        int64_t r = c.r > 0 ? c.r : 0;
+        if (c.xc - r < INT16_MIN || c.xc + r > INT16_MAX) return false;
+        if (c.yc - r < INT16_MIN || c.yc + r > INT16_MAX) return false;
+    }
+    return true;
+}
+
+template <typename T, bool Unique>
+static size_t circlesPixels(const Circle* circles, size_t count, T* xy)
+{
+    T* p = xy;
+
+    for (size_t i = 0; i < count; i++) {
+        const int xc = circles[i].xc, yc = circles[i].yc;
+        int x = 0, y = circles[i].r;
+        int d = 3 - 2 * y;
+
+        while (x <= y) {
+            if (Unique && y == 0) {
+                // r == 0: a single pixel.
+                p[0] = xc; p[1] = yc;
+                p += 2;
+            } else if (Unique && x == 0) {
+                // (+-0, y) and (y, +-0) coincide in pairs.
+                p[0] = xc;     p[1] = yc + y;
+                p[2] = xc;     p[3] = yc - y;
+                p[4] = xc + y; p[5] = yc;
+                p[6] = xc - y; p[7] = yc;
+                p += 8;
+            } else if (Unique && x == y) {
+                // The mirrored half equals the first half.
+                p[0] = xc + x; p[1] = yc + y;
+                p[2] = xc - x; p[3] = yc + y;
+                p[4] = xc + x; p[5] = yc - y;
+                p[6] = xc - x; p[7] = yc - y;
+                p += 8;
+            } else {
+                p[0]  = xc + x; p[1]  = yc + y;
+                p[2]  = xc - x; p[3]  = yc + y;
+                p[4]  = xc + x; p[5]  = yc - y;
+                p[6]  = xc - x; p[7]  = yc - y;
+                p[8]  = xc + y; p[9]  = yc + x;
+                p[10] = xc - y; p[11] = yc + x;
+                p[12] = xc + y; p[13] = yc - x;
+                p[14] = xc - y; p[15] = yc - x;
+                p += 16;
+            }
+
+            if (d < 0)
+                d = d + 4 * x + 6;
+            else {
+                d = d + 4 * (x - y) + 10;
+                y--;
+            }
+            x++;
+        }
+    }
+
+    return (size_t)(p - xy) / 2;
+}
+
+size_t bresenhamCirclesPixels(const Circle* circles, size_t count, int16_t* xy)
+{
+    return circlesPixels<int16_t, false>(circles, count, xy);
+}
+
+size_t bresenhamCirclesPixels(const Circle* circles, size_t count, int32_t* xy)
+{
+    return circlesPixels<int32_t, false>(circles, count, xy);
+}
+
+size_t bresenhamCircleUniquePointCount(int r)
+{
+    if (r < 0) return 0;
+    if (r == 0) return 1;
+
+    // Steps are distinct pixels except x == 0 (always the first step) and
+    // x == y (only possibly the last one), which give 4 pixels each.
+    size_t steps = bresenhamOctantSteps(r);
+    int last = (int)steps - 1;
+    size_t n = 8 * steps - 4;
+    if (last > 0 && bresenhamY(last, r) == last)
+        n -= 4;
+    return n;
+}
+
+size_t bresenhamCirclesUniquePointCount(const Circle* circles, size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+        total += bresenhamCircleUniquePointCount(circles[i].r);
+    return total;
+}
+
+size_t bresenhamCirclesPixelsUnique(const Circle* circles, size_t count, int16_t* xy)
+{
+    return circlesPixels<int16_t, true>(circles, count, xy);
+}
+
+size_t bresenhamCirclesPixelsUnique(const Circle* circles, size_t count, int32_t* xy)
+{
+    return circlesPixels<int32_t, true>(circles, count, xy);
+}
+
+RasterPath rasterBestPath()
+{
+#ifdef RASTER_X86
+    if (__builtin_cpu_supports("avx2")) return RASTER_AVX2;
+    if (__builtin_cpu_supports("sse2")) return RASTER_SSE2;
+#endif
+    return RASTER_SCALAR;
+}
+
+const char* rasterPathName(RasterPath path)
+{
+    switch (path) {
+        case RASTER_AUTO:   return "auto";
+        case RASTER_SCALAR: return "scalar";
+        case RASTER_SSE2:   return "sse2";
+        case RASTER_AVX2:   return "avx2";
+    }
+    return "?";
+}
+
+/**
+ * Decision variable of the Bresenham loop at (x, y).
+ *
+ * Matches d = 3 - 2r at x = 0 and both incremental updates of the loop.
+ */
+static int bresenhamD(int x, int y, int r)
+{
+    return (int)(2 * (int64_t)(x + 1) * (x + 1) + (int64_t)y * y + (int64_t)(y - 1) * (y - 1)
+                 - 2 * (int64_t)r * r);
+}
+
+/*
+ * The kernels below emit the octant steps x in [x0, x1), re-deriving y and d
+ * at x0 so that any range can be generated independently. Every step gives
+ *   xs = xc + ( x, -x,  x, -x,  y, -y,  y, -y)
+ *   ys = yc + ( y,  y, -y, -y,  x,  x, -x, -x)
+ * which is the order of plotCirclePoints in bresenhamCircle.
+ */
+
+static void circleSoAScalar(int xc, int yc, int r, int x0, int x1, int* px, int* py)
+{
+    int y = bresenhamY(x0, r);
+    int d = bresenhamD(x0, y, r);
+
+    for (int x = x0; x < x1; x++) {
+        px[0] = xc + x; py[0] = yc + y;
+        px[1] = xc - x; py[1] = yc + y;
+        px[2] = xc + x; py[2] = yc - y;
+        px[3] = xc - x; py[3] = yc - y;
+        px[4] = xc + y; py[4] = yc + x;
+        px[5] = xc - y; py[5] = yc + x;
+        px[6] = xc + y; py[6] = yc - x;
+        px[7] = xc - y; py[7] = yc - x;
+        px += 8;
+        py += 8;
+
+        if (d < 0)
+            d = d + 4 * x + 6;
+        else {
+            d = d + 4 * (x - y) + 10;
+            y--;
+        }
+    }
+}
+
+#ifdef RASTER_X86
+static void circleSoASSE2(int xc, int yc, int r, int x0, int x1, int* xs, int* ys)
+{
+    // Negation masks: (v ^ m) - m flips the lanes where m is -1.
+    const __m128i negX = _mm_setr_epi32(0, -1, 0, -1);
+    const __m128i negY = _mm_setr_epi32(0, 0, -1, -1);
+    const __m128i cx = _mm_set1_epi32(xc);
+    const __m128i cy = _mm_set1_epi32(yc);
+
+    int y = bresenhamY(x0, r);
+    int d = bresenhamD(x0, y, r);
+
+    for (int x = x0; x < x1; x++) {
+        __m128i v  = _mm_cvtsi32_si128(x);
+        v = _mm_unpacklo_epi32(v, _mm_cvtsi32_si128(y));      // (x, y, 0, 0)
+        __m128i vx = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 0, 0, 0));
+        __m128i vy = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1));
+
+        __m128i ox0 = _mm_add_epi32(cx, _mm_sub_epi32(_mm_xor_si128(vx, negX), negX));
+        __m128i ox1 = _mm_add_epi32(cx, _mm_sub_epi32(_mm_xor_si128(vy, negX), negX));
+        __m128i oy0 = _mm_add_epi32(cy, _mm_sub_epi32(_mm_xor_si128(vy, negY), negY));
+        __m128i oy1 = _mm_add_epi32(cy, _mm_sub_epi32(_mm_xor_si128(vx, negY), negY));
+
+        _mm_storeu_si128((__m128i*)xs, ox0);
+        _mm_storeu_si128((__m128i*)(xs + 4), ox1);
+        _mm_storeu_si128((__m128i*)ys, oy0);
+        _mm_storeu_si128((__m128i*)(ys + 4), oy1);
+        xs += 8;
+        ys += 8;
+
+        if (d < 0)
+            d = d + 4 * x + 6;
+        else {
+            d = d + 4 * (x - y) + 10;
+            y--;
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void circleSoAAVX2(int xc, int yc, int r, int x0, int x1, int* xs, int* ys)
+{
+    const __m256i signX = _mm256_setr_epi32(1, -1, 1, -1, 1, -1, 1, -1);
+    const __m256i signY = _mm256_setr_epi32(1, 1, -1, -1, 1, 1, -1, -1);
+    const __m256i permX = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+    const __m256i permY = _mm256_setr_epi32(1, 1, 1, 1, 0, 0, 0, 0);
+    const __m256i cx = _mm256_set1_epi32(xc);
+    const __m256i cy = _mm256_set1_epi32(yc);
+
+    int y = bresenhamY(x0, r);
+    int d = bresenhamD(x0, y, r);
+
+    for (int x = x0; x < x1; x++) {
+        __m256i v  = _mm256_castsi128_si256(_mm_unpacklo_epi32(_mm_cvtsi32_si128(x), _mm_cvtsi32_si128(y)));
+        __m256i vx = _mm256_sign_epi32(_mm256_permutevar8x32_epi32(v, permX), signX);
+        __m256i vy = _mm256_sign_epi32(_mm256_permutevar8x32_epi32(v, permY), signY);
+
+        _mm256_storeu_si256((__m256i*)xs, _mm256_add_epi32(cx, vx));
+        _mm256_storeu_si256((__m256i*)ys, _mm256_add_epi32(cy, vy));
+        xs += 8;
+        ys += 8;
+
+        if (d < 0)
+            d = d + 4 * x + 6;
+        else {
+            d = d + 4 * (x - y) + 10;
+            y--;
+        }
+    }
+}
+#endif
+
+/** Emits octant steps [x0, x1) with the given path. */
+static void circleSoARange(int xc, int yc, int r, int x0, int x1, int* xs, int* ys, RasterPath path)
+{
+    switch (path) {
+#ifdef RASTER_X86
+        case RASTER_AVX2: circleSoAAVX2(xc, yc, r, x0, x1, xs, ys); break;
+        case RASTER_SSE2: circleSoASSE2(xc, yc, r, x0, x1, xs, ys); break;
+#endif
+        default:          circleSoAScalar(xc, yc, r, x0, x1, xs, ys); break;
+    }
+}
+
+static RasterPath resolvePath(RasterPath path)
+{
+    RasterPath best = rasterBestPath();
+    return (path == RASTER_AUTO || path > best) ? best : path;
+}
+
+size_t bresenhamCircleSoA(int xc, int yc, int r, int* xs, int* ys, RasterPath path)
+{
+    int steps = (int)bresenhamOctantSteps(r);
+    circleSoARange(xc, yc, r, 0, steps, xs, ys, resolvePath(path));
+    return 8 * (size_t)steps;
+}
+
+size_t bresenhamCircleParallel(int xc, int yc, int r, int* xs, int* ys, ThreadPool& pool, RasterPath path)
+{
+    // Below this many steps per chunk the closed-form restart is not worth it.
+    const int minChunk = 4096;
+
+    int steps = (int)bresenhamOctantSteps(r);
+    path = resolvePath(path);
+
+    int chunks = std::min((int)pool.size() * 4, steps / minChunk);
+    if (chunks <= 1) {
+        circleSoARange(xc, yc, r, 0, steps, xs, ys, path);
+        return 8 * (size_t)steps;
+    }
+
+    pool.parallelFor(chunks, [&](size_t i) {
+        int x0 = (int)((int64_t)steps * i / chunks);
+        int x1 = (int)((int64_t)steps * (i + 1) / chunks);
+        circleSoARange(xc, yc, r, x0, x1, xs + 8 * (size_t)x0, ys + 8 * (size_t)x0, path);
+    });
+    return 8 * (size_t)steps;
+}
+
+size_t bresenhamCirclesSoA(const Circle* circles, size_t count, int* xs, int* ys, RasterPath path)
+{
+    path = resolvePath(path);
+
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++)
+        n += bresenhamCircleSoA(circles[i].xc, circles[i].yc, circles[i].r, xs + n, ys + n, path);
+    return n;
+}
+
+size_t spanPixelCount(const Span* spans, size_t count)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++)
+        n += spans[i].x1 - spans[i].x0 + 1;
+    return n;
+}
+
+size_t filledCircleSpanCount(int r)
+{
+    return r < 0 ? 0 : 2 * (size_t)r + 1;
+}
+
+size_t filledCircleSpans(int xc, int yc, int r, Span* out)
+{
+    if (r < 0) return 0;
+
+    // Row yc + k goes to out[r + k]; widths only grow while the loop runs.
+    auto row = [&](int k, int w) {
+        Span& top = out[r - k];
+        Span& bottom = out[r + k];
+        if (top.x1 - xc >= w) return;
+        top = Span{yc - k, xc - w, xc + w};
+        bottom = Span{yc + k, xc - w, xc + w};
+    };
+
+    for (int k = 0; k <= r; k++)
+        out[r - k].x1 = out[r + k].x1 = xc - 1;
+
+    int x = 0, y = r;
+    int d = 3 - 2 * r;
+
+    while (x <= y) {
+        row(x, y);
+        row(y, x);
+        if (d < 0)
+            d = d + 4 * x + 6;
+        else {
+            d = d + 4 * (x - y) + 10;
+            y--;
+        }
+        x++;
+    }
+
+    return 2 * (size_t)r + 1;
+}
+
+size_t filledEllipseSpanCount(int a, int b)
+{
+    return (a < 0 || b < 0) ? 0 : 2 * (size_t)b + 1;
+}
+
+size_t filledEllipseSpans(int xc, int yc, int a, int b, Span* out)
+{
+    if (a < 0 || b < 0) return 0;
+    if (b == 0) {
+        out[0] = Span{yc, xc - a, xc + a};
+        return 1;
+    }
+
+    // x only grows as y goes down, so the last x seen on a row is its width.
+    auto row = [&](int x, int y) {
+        out[b - y] = Span{yc - y, xc - x, xc + x};
+        out[b + y] = Span{yc + y, xc - x, xc + x};
+    };
+
+    const int64_t a2 = (int64_t)a * a;
+    const int64_t b2 = (int64_t)b * b;
+    int x = 0, y = b;
+
+    // Region 1 (slope > -1): p = 4 f(x + 1, y - 1/2).
+    int64_t p = 4 * b2 - 4 * a2 * b + a2;
+    while (b2 * x < a2 * y) {
+        row(x, y);
+        if (p < 0) {
+            p += 4 * b2 * (2 * x + 3);
+        } else {
+            p += 4 * b2 * (2 * x + 3) - 8 * a2 * (y - 1);
+            y--;
+        }
+        x++;
+    }
+
+    // Region 2 (slope < -1): q = 4 f(x + 1/2, y - 1).
+    int64_t q = b2 * (2 * x + 1) * (2 * x + 1) + 4 * a2 * (y - 1) * (y - 1) - 4 * a2 * b2;
+    while (y >= 0) {
+        row(x, y);
+        if (q > 0) {
+            q -= 4 * a2 * (2 * y - 3);
+        } else {
+            q += 8 * b2 * (x + 1) - 4 * a2 * (2 * y - 3);
+            x++;
+        }
+        y--;
+    }
+
+    return 2 * (size_t)b + 1;
+}
+
+size_t arcSpanMaxCount(int r)
+{
+    return 2 * filledCircleSpanCount(r);
+}
+
+/**
+ * Integer x range of a row where A*x + B >= 0, clamped to [lo, hi].
+ *
+ * @return False if the range is empty.
+ */
+static bool halfPlaneRange(double A, double B, int& lo, int& hi)
+{
+    if (A == 0.0) return B >= 0.0 && lo <= hi;
+    if (lo > hi) return false;
+
+    // Start from the rounded root, clamped to the row, then fix rounding.
+    double t = -B / A;
+    if (A > 0.0) {
+        int x = t <= lo ? lo : (t > hi ? hi + 1 : (int)std::ceil(t));
+        while (x > lo && A * (x - 1) + B >= 0.0) x--;
+        while (x <= hi && A * x + B < 0.0) x++;
+        lo = x;
+    } else {
+        int x = t >= hi ? hi : (t < lo ? lo - 1 : (int)std::floor(t));
+        while (x < hi && A * (x + 1) + B >= 0.0) x++;
+        while (x >= lo && A * x + B < 0.0) x--;
+        hi = x;
+    }
+    return lo <= hi;
+}
+
+size_t arcSpans(int xc, int yc, int r, float startDeg, float endDeg, Span* out)
+{
+    if (r < 0) return 0;
+
+    float sweep = endDeg - startDeg;
+    if (sweep >= 360.0f || sweep <= -360.0f)
+        return filledCircleSpans(xc, yc, r, out);
+    sweep = std::fmod(sweep + 360.0f, 360.0f);
+
+    const double a0 = startDeg * M_PI / 180.0;
+    const double a1 = (startDeg + sweep) * M_PI / 180.0;
+    const double u0x = std::cos(a0), u0y = std::sin(a0);
+    const double u1x = std::cos(a1), u1y = std::sin(a1);
+
+    // Disc rows are written at the end of the buffer and read in order, so
+    // the (up to two per row) arc spans never overtake them.
+    size_t rows = filledCircleSpanCount(r);
+    Span* disc = out + arcSpanMaxCount(r) - rows;
+    filledCircleSpans(xc, yc, r, disc);
+
+    size_t n = 0;
+    for (size_t i = 0; i < rows; i++) {
+        const Span s = disc[i];
+        const int dy = s.y - yc;
+
+        // Inside start edge: cross(u0, p) >= 0; inside end edge: cross(p, u1) >= 0.
+        int lo0 = s.x0 - xc, hi0 = s.x1 - xc;
+        int lo1 = lo0, hi1 = hi0;
+        bool in0 = halfPlaneRange(-u0y, u0x * dy, lo0, hi0);
+        bool in1 = halfPlaneRange(u1y, -u1x * dy, lo1, hi1);
+
+        if (sweep <= 180.0f) {
+            int lo = std::max(lo0, lo1), hi = std::min(hi0, hi1);
+            if (in0 && in1 && lo <= hi)
+                out[n++] = Span{s.y, xc + lo, xc + hi};
+        } else if (in0 && in1 && hi0 + 1 >= lo1 && hi1 + 1 >= lo0) {
+            // Union of the two half-planes, overlapping: one span.
+            out[n++] = Span{s.y, xc + std::min(lo0, lo1), xc + std::max(hi0, hi1)};
+        } else {
+            // Disjoint pieces, left one first.
+            if (in0 && in1 && lo1 < lo0) {
+                std::swap(lo0, lo1);
+                std::swap(hi0, hi1);
+            }
+            if (in0) out[n++] = Span{s.y, xc + lo0, xc + hi0};
+            if (in1) out[n++] = Span{s.y, xc + lo1, xc + hi1};
+        }
+    }
+
+    return n;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file raster.h
+ * Bresenham circle rasterization shared by the demos and benchmarks.
+ */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class ThreadPool;
+
+/** Circle given by its center and radius, in pixels. */
+struct Circle
+{
+    int xc, yc, r;
+};
+
+/**
+ * Generates one circle, appending 8 mirrored points per step to out.
+ *
+ * This is the original per-call version, kept as the reference output.
+ *
+ * @param xc Center x coordinate.
+ * @param yc Center y coordinate.
+ * @param r Radius.
+ * @param out Vector receiving the points.
+ */
+void bresenhamCircle(int xc, int yc, int r, std::vector<glm::vec3>& out);
+
+/**
+ * Number of steps of the first octant loop (x <= y) for radius r.
+ *
+ * Computed in closed form, without running the loop.
+ */
+size_t bresenhamOctantSteps(int r);
+
+/** Number of points bresenhamCircle emits for radius r. */
+size_t bresenhamCirclePointCount(int r);
+
+/** Total number of points for a batch of circles. */
+size_t bresenhamCirclesPointCount(const Circle* circles, size_t count);
+
+/**
+ * Generates a batch of circles into a caller-provided buffer.
+ *
+ * The buffer must hold bresenhamCirclesPointCount(circles, count) points.
+ * Output is identical to calling bresenhamCircle for each circle in order.
+ *
+ * @param circles Array of circles.
+ * @param count Number of circles.
+ * @param out Output buffer.
+ * @return Number of points written.
+ */
+size_t bresenhamCircles(const Circle* circles, size_t count, glm::vec3* out);
+
+/** True if every point of the circles fits in int16_t coordinates. */
+bool circlesFitInt16(const Circle* circles, size_t count);
+
+/**
+ * Generates a batch of circles as interleaved integer pixel coordinates.
+ *
+ * xy receives (x, y) pairs, 2 * bresenhamCirclesPointCount() values, in
+ * the order of bresenhamCircles. The int16_t version requires
+ * circlesFitInt16().
+ *
+ * @return Number of points written.
+ */
+size_t bresenhamCirclesPixels(const Circle* circles, size_t count, int16_t* xy);
+size_t bresenhamCirclesPixels(const Circle* circles, size_t count, int32_t* xy);
+
+/**
+ * Number of distinct pixels of a circle.
+ *
+ * bresenhamCircle repeats pixels on the steps where x == 0 or x == y; this
+ * is the count without those repeats, computed in closed form.
+ */
+size_t bresenhamCircleUniquePointCount(int r);
+
+/** Total number of distinct pixels for a batch of circles. */
+size_t bresenhamCirclesUniquePointCount(const Circle* circles, size_t count);
+
+/**
+ * Exact-output version of bresenhamCirclesPixels: every pixel of a circle
+ * is written once, keeping the first occurrence in bresenhamCircle order.
+ *
+ * xy must hold 2 * bresenhamCirclesUniquePointCount() values.
+ *
+ * @return Number of points written.
+ */
+size_t bresenhamCirclesPixelsUnique(const Circle* circles, size_t count, int16_t* xy);
+size_t bresenhamCirclesPixelsUnique(const Circle* circles, size_t count, int32_t* xy);
+
+/** Code path used to expand the octants into the output. */
+enum RasterPath { RASTER_AUTO, RASTER_SCALAR, RASTER_SSE2, RASTER_AVX2 };
+
+/** Best path supported by the running CPU. */
+RasterPath rasterBestPath();
+
+/** Human readable name of a path. */
+const char* rasterPathName(RasterPath path);
+
+/**
+ * Generates one circle in structure-of-arrays form.
+ *
+ * xs and ys must hold bresenhamCirclePointCount(r) entries each. Points are
+ * written in the same order as bresenhamCircle. Paths the CPU does not
+ * support fall back to the best available one.
+ *
+ * @param xc Center x coordinate.
+ * @param yc Center y coordinate.
+ * @param r Radius.
+ * @param xs Output x coordinates.
+ * @param ys Output y coordinates.
+ * @param path Code path to use.
+ * @return Number of points written.
+ */
+size_t bresenhamCircleSoA(int xc, int yc, int r, int* xs, int* ys, RasterPath path = RASTER_AUTO);
+
+/** Batched version of bresenhamCircleSoA, circles written back to back. */
+size_t bresenhamCirclesSoA(const Circle* circles, size_t count, int* xs, int* ys, RasterPath path = RASTER_AUTO);
+
+/**
+ * Parallel version of bresenhamCircleSoA for very large radii.
+ *
+ * The first octant is split into x ranges; each task re-derives y and the
+ * decision variable at its first x in closed form and fills its own slice
+ * of the output. Small circles run on the calling thread.
+ *
+ * @param pool Thread pool running the ranges.
+ */
+size_t bresenhamCircleParallel(int xc, int yc, int r, int* xs, int* ys, ThreadPool& pool, RasterPath path = RASTER_AUTO);
+
+/** Horizontal run of pixels [x0, x1] on row y, inclusive. */
+struct Span
+{
+    int y, x0, x1;
+};
+
+/** Number of pixels covered by a list of spans. */
+size_t spanPixelCount(const Span* spans, size_t count);
+
+/** Number of spans of a filled circle (2r + 1, one per row). */
+size_t filledCircleSpanCount(int r);
+
+/**
+ * Filled circle as one span per row, top row first.
+ *
+ * Uses the Bresenham loop of bresenhamCircle, so span ends are exactly
+ * the outline points.
+ *
+ * @param out Buffer of filledCircleSpanCount(r) spans.
+ * @return Number of spans written.
+ */
+size_t filledCircleSpans(int xc, int yc, int r, Span* out);
+
+/** Number of spans of a filled ellipse (2b + 1, one per row). */
+size_t filledEllipseSpanCount(int a, int b);
+
+/**
+ * Filled axis-aligned ellipse as one span per row, top row first.
+ *
+ * Midpoint ellipse algorithm (both regions) in integer arithmetic.
+ *
+ * @param a Semi-axis along x.
+ * @param b Semi-axis along y.
+ * @param out Buffer of filledEllipseSpanCount(a, b) spans.
+ * @return Number of spans written.
+ */
+size_t filledEllipseSpans(int xc, int yc, int a, int b, Span* out);
+
+/** Upper bound of spans of a filled arc (up to two per row). */
+size_t arcSpanMaxCount(int r);
+
+/**
+ * Filled circular arc segment (sector) from start to end angle.
+ *
+ * Angles are in degrees, measured from +x towards +y in pixel coordinates.
+ * Rows are clipped against the two bounding half-planes, giving at most
+ * two spans per row.
+ *
+ * @param out Buffer of arcSpanMaxCount(r) spans.
+ * @return Number of spans written.
+ */
+size_t arcSpans(int xc, int yc, int r, float startDeg, float endDeg, Span* out);
+
+#endif
@@ -0,0 +1,126 @@
+/**
+ * @file stream_buffer.cpp
+ * Vertex array of 2D points streamed through a ring buffer.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <GL/glew.h>
+#include "stream_buffer.h"
+
+/** Smallest ring, in vertices. */
+static const size_t MIN_CAPACITY = 4096;
+
+void StreamBuffer::allocate(size_t vertices)
+{
+    if (VAO == 0) glGenVertexArrays(1, &VAO);
+
+    // Pending draws keep the old buffer alive until they are done.
+    for (const Fence& f : fences)
+        glDeleteSync((GLsync)f.sync);
+    fences.clear();
+    if (VBO != 0) glDeleteBuffers(1, &VBO);
+    glGenBuffers(1, &VBO);
+
+    capacity = vertices;
+    GLsizeiptr bytes = capacity * sizeof(glm::vec2);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (GLEW_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bytes, NULL, flags);
+        mapped = (glm::vec2*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        mapped = nullptr;
+    }
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    base = count = 0;
+}
+
+void StreamBuffer::waitRange(size_t begin, size_t end)
+{
+    // Drop fences already passed, oldest first, so the list stays short.
+    while (!fences.empty() && glClientWaitSync((GLsync)fences.front().sync, 0, 0) != GL_TIMEOUT_EXPIRED) {
+        glDeleteSync((GLsync)fences.front().sync);
+        fences.pop_front();
+    }
+
+    for (std::deque<Fence>::iterator it = fences.begin(); it != fences.end();) {
+        if (it->begin < end && begin < it->end) {
+            GLsync sync = (GLsync)it->sync;
+            while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(sync);
+            it = fences.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void StreamBuffer::update(const glm::vec2* points, size_t n, size_t changed)
+{
+    changed = std::min(changed, std::min(count, n));
+
+    // The new data goes right after the current one, or at the start of the
+    // ring if it does not fit; it must not overlap the current data, which
+    // may still be drawn and is the source of the unchanged prefix.
+    size_t start = base + count;
+    bool wrap = start + n > capacity;
+    if (wrap) start = 0;
+    if (capacity == 0 || n > capacity / 2 || (wrap && n > base)) {
+        allocate(std::max(std::max(2 * capacity, 4 * n), MIN_CAPACITY));
+        start = 0;
+        changed = 0;
+        wrap = false;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    if (wrap && !mapped) {
+        // Orphan: the driver gives fresh storage, the old data goes with it.
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec2), NULL, GL_STREAM_DRAW);
+        changed = 0;
+    }
+    if (mapped)
+        waitRange(start, start + n);
+
+    if (changed > 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, base * sizeof(glm::vec2),
+                            start * sizeof(glm::vec2), changed * sizeof(glm::vec2));
+    }
+
+    // The old range is free once the draws and the copy issued so far are done.
+    if (mapped && count > 0) {
+        Fence f = {base, base + count, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)};
+        fences.push_back(f);
+    }
+
+    size_t tail = n - changed;
+    if (tail > 0) {
+        if (mapped) {
+            memcpy(mapped + start + changed, points + changed, tail * sizeof(glm::vec2));
+        } else {
+            // Nothing drawn since the last orphan used this range.
+            void* dst = glMapBufferRange(GL_ARRAY_BUFFER, (start + changed) * sizeof(glm::vec2),
+                                         tail * sizeof(glm::vec2),
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            memcpy(dst, points + changed, tail * sizeof(glm::vec2));
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+    }
+
+    base = start;
+    count = n;
+}
+
+void StreamBuffer::bind() const
+{
+    glBindVertexArray(VAO);
+}
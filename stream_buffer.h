@@ -0,0 +1,83 @@
+/**
+ * @file stream_buffer.h
+ * Vertex array of 2D points streamed through a ring buffer.
+ */
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <cstddef>
+#include <deque>
+#include <glm/glm.hpp>
+
+/**
+ * Vertex array object with one glm::vec2 attribute (location 0), for
+ * geometry that is uploaded again often.
+ *
+ * Every upload goes to fresh space after the previous one in a ring, so
+ * the GPU can keep drawing the old vertices while the new ones are
+ * written, and no storage is re-specified. With ARB_buffer_storage the
+ * ring is mapped once, persistently, and written with memcpy; fences keep
+ * a range from being overwritten before the draws reading it are done.
+ * Without it, each write maps its range unsynchronized, and the buffer is
+ * orphaned when the ring wraps.
+ *
+ * The data does not start at vertex 0: draw from first(), e.g.
+ * glDrawArrays(mode, first(), size()) or glDrawElementsBaseVertex with
+ * first() as base vertex. Objects are created on the first upload, which
+ * needs a current context.
+ */
+class StreamBuffer
+{
+public:
+    StreamBuffer() {}
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    /** Replaces the vertices. */
+    void upload(const glm::vec2* points, size_t n) { update(points, n, 0); }
+
+    /**
+     * Replaces the vertices when only [changed, n) differ from the last
+     * upload: the unchanged prefix is copied on the GPU and only the rest
+     * is written from points.
+     *
+     * @param points All n vertices.
+     * @param n Number of vertices.
+     * @param changed First vertex that differs from the last upload.
+     */
+    void update(const glm::vec2* points, size_t n, size_t changed);
+
+    /** Binds the vertex array, e.g. to attach an index buffer or draw. */
+    void bind() const;
+
+    /** Vertex where the current data starts. */
+    int first() const { return (int)base; }
+
+    /** Number of vertices of the current data. */
+    size_t size() const { return count; }
+
+    /** True if the ring is persistently mapped. */
+    bool persistent() const { return mapped != nullptr; }
+
+private:
+    /** A range that draws issued before sync may still read. */
+    struct Fence
+    {
+        size_t begin, end;
+        void* sync;  // GLsync
+    };
+
+    void allocate(size_t vertices);
+    void waitRange(size_t begin, size_t end);
+
+    unsigned int VAO = 0, VBO = 0;
+    /** Ring size, in vertices. */
+    size_t capacity = 0;
+    /** Current data: [base, base + count). */
+    size_t base = 0, count = 0;
+    glm::vec2* mapped = nullptr;
+    std::deque<Fence> fences;
+};
+
+#endif
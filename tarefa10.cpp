@@ -15,6 +15,11 @@
 #include <glm/gtx/string_cast.hpp>
 #include "../lib/utils.h"
 #include <vector>
+#include "program_cache.h"
+#include "clip.h"
+#include "window_clip.h"
+#include "triangulate.h"
+#include "stream_buffer.h"
 
 
 /* Globals */
@@ -25,13 +30,43 @@ int win_height = 600;
 
 /** Program variable. */
 int program;
-/** Vertex array object. */
-unsigned int VAOretangle, VAOpolygon;
-/** Vertex buffer object. */
-unsigned int VBOretangle, VBOpolygon;
+/** Uniform slots of the program. */
+enum Uniform { U_MODEL, U_VIEW, U_PROJECTION, U_COLOR };
+/** Cached uniform locations and values. */
+ProgramCache uniforms;
+/** Transforms; fixed for this program, so computed once. */
+glm::mat4 model, view, projection;
+/** Vertices of the window, the polygon and the clipped pieces. */
+StreamBuffer windowStream, polygonStream, clippedStream;
+
+/** Index buffers with the triangulations of the polygon and of the clipped pieces. */
+unsigned int EBOpolygon, EBOclipped;
+/** Number of indices in each index buffer. */
+int polygonIndexCount, clippedIndexCount;
 
-unsigned int VAOclipped, VBOclipped;
 std::vector<glm::vec2> clippedPolygon;
+/** First vertex and vertex count of each clipped piece in clippedPolygon. */
+std::vector<int> pieceFirst, pieceCount;
+/** Triangulations, redone only when the polygon or a piece changes. */
+TriangulationCache polygonTriangles;
+std::vector<TriangulationCache> pieceTriangles;
+std::vector<uint32_t> clippedIndices;
+
+/** Clip of the polygon being drawn: one clipEdgeToRectangle run per edge. */
+std::vector<glm::vec2> previewClipped;
+/** Where the run of the closing edge starts in previewClipped. */
+size_t previewClosing = 0;
+/** True while previewClipped follows the polygon (unrotated rectangle only). */
+bool previewValid = false;
+/** Buffers reused by every clip. */
+ClipScratch clipScratch;
+
+/** Clip window: the selected rectangle, possibly rotated, or a drawn polygon. */
+std::vector<glm::vec2> windowPoints;
+ClipWindow clipWindow;
+bool windowIsRectangle = true;
+/** Rotation of the rectangle window, in degrees. */
+float windowAngle = 0.0f;
 
 
 
@@ -40,7 +75,7 @@ glm::vec2 points[2];
 int click_count = 0;      
 bool ready_to_draw = false;
 
-enum Mode { SELECT_RECTANGLE, SELECT_POLYGON };
+enum Mode { SELECT_RECTANGLE, SELECT_WINDOW, SELECT_POLYGON };
 Mode mode = SELECT_RECTANGLE;
 
 std::vector<glm::vec2> polygonPoints;
@@ -50,7 +85,7 @@ bool draw_polygon = false;
 /** Vertex shader. */
 const char *vertex_code = "\n"
 "#version 330 core\n"
-"layout (location = 0) in vec3 position;\n"
+"layout (location = 0) in vec2 position;\n"
 "\n"
 "uniform mat4 model;\n"
 "uniform mat4 view;\n"
@@ -58,7 +93,7 @@ const char *vertex_code = "\n"
 "\n"
 "void main()\n"
 "{\n"
-"    gl_Position = projection * view * model * vec4(position, 1.0);\n"
+"    gl_Position = projection * view * model * vec4(position, 0.0, 1.0);\n"
 "}\0";
 
 const char *fragment_code = R"(
@@ -77,44 +112,76 @@ void reshape(int, int);
 void keyboard(unsigned char, int, int);
 void initData(void);
 void initShaders(void);
-std::vector<glm::vec2> sutherlandHodgman(const std::vector<glm::vec2>& polygon, glm::vec2 pMin, glm::vec2 pMax);
+void updateWindow(void);
+void clipPolygon(void);
+void rebuildPreview(void);
+
+/**
+ * Fills a polygon of any shape, even self-intersecting, with the even-odd
+ * rule and no triangulation: a fan flips the stencil bit of every pixel it
+ * covers, then a second fan colors the pixels left odd and clears them.
+ *
+ * @param polygon Vertices of the polygon.
+ * @param color Fill color.
+ */
+void drawEvenOdd(const StreamBuffer& polygon, glm::vec3 color)
+{
+    polygon.bind();
+    glEnable(GL_STENCIL_TEST);
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glStencilFunc(GL_ALWAYS, 0, 1);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+    glDrawArrays(GL_TRIANGLE_FAN, polygon.first(), polygon.size());
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glStencilFunc(GL_NOTEQUAL, 0, 1);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+    uniforms.setVec3(U_COLOR, color);
+    glDrawArrays(GL_TRIANGLE_FAN, polygon.first(), polygon.size());
+
+    glDisable(GL_STENCIL_TEST);
+}
 
 /** 
  * Drawing function.
  *
- * Draws primitive.
+ * Draws primitive. While the polygon is being drawn it is previewed,
+ * clipped, with drawEvenOdd, since it may not be simple yet.
  */
 void display()
 {
     glClearColor(0.2, 0.3, 0.3, 1.0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-    glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
-    glm::mat4 projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+    uniforms.use();
+    uniforms.setMat4(U_MODEL, model);
+    uniforms.setMat4(U_VIEW, view);
+    uniforms.setMat4(U_PROJECTION, projection);
 
-    glUseProgram(program);
-    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    if ((ready_to_draw || mode == SELECT_WINDOW) && !windowPoints.empty()) {
+        windowStream.bind();
+        uniforms.setVec3(U_COLOR, glm::vec3(1.0f, 0.0f, 0.0f));
+        glDrawArrays(GL_LINE_LOOP, windowStream.first(), windowStream.size());
+    }
 
-    if (ready_to_draw) {
-        glBindVertexArray(VAOretangle);
-        glUniform3f(glGetUniformLocation(program, "color"), 1.0f, 0.0f, 0.0f);
-        glDrawArrays(GL_LINE_LOOP, 0, 4);
+    if (!draw_polygon && polygonPoints.size() >= 2) {
+        drawEvenOdd(polygonStream, glm::vec3(0.0f, 0.0f, 1.0f));
+        if (previewValid)
+            drawEvenOdd(clippedStream, glm::vec3(0.0f, 1.0f, 0.0f));
     }
 
     if (draw_polygon) {
         if (!polygonPoints.empty()) {
-            glBindVertexArray(VAOpolygon);
-            glUniform3f(glGetUniformLocation(program, "color"), 0.0f, 0.0f, 1.0f);
-            glDrawArrays(GL_TRIANGLE_FAN, 0, polygonPoints.size());
+            polygonStream.bind();
+            uniforms.setVec3(U_COLOR, glm::vec3(0.0f, 0.0f, 1.0f));
+            glDrawElementsBaseVertex(GL_TRIANGLES, polygonIndexCount, GL_UNSIGNED_INT, 0, polygonStream.first());
         }
 
         if (!clippedPolygon.empty()) {
-            glBindVertexArray(VAOclipped);
-            glUniform3f(glGetUniformLocation(program, "color"), 0.0f, 1.0f, 0.0f);
-            glDrawArrays(GL_TRIANGLE_FAN, 0, clippedPolygon.size());
+            clippedStream.bind();
+            uniforms.setVec3(U_COLOR, glm::vec3(0.0f, 1.0f, 0.0f));
+            glDrawElementsBaseVertex(GL_TRIANGLES, clippedIndexCount, GL_UNSIGNED_INT, 0, clippedStream.first());
         }
     }
 
@@ -142,6 +209,8 @@ void reshape(int width, int height)
  * Keyboard function.
  *
  * Called to treat pressed keys.
+ * 'w' starts drawing a polygon clip window (left clicks add vertices,
+ * right click closes it); 'r' rotates the rectangle window by 15 degrees.
  *
  * @param key Pressed key.
  * @param x Mouse x coordinate when key pressed.
@@ -151,6 +220,21 @@ void keyboard(unsigned char key, int x, int y)
 {
         switch (key)
         {
+                case 'w':
+                case 'W':
+                        mode = SELECT_WINDOW;
+                        windowPoints.clear();
+                        windowIsRectangle = false;
+                        ready_to_draw = false;
+                        previewValid = false;
+                        break;
+                case 'r':
+                case 'R':
+                        if (windowIsRectangle && click_count == 2) {
+                                windowAngle += 15.0f;
+                                updateWindow();
+                        }
+                        break;
                 case 27:
                         glutLeaveMainLoop();
                 case 'q':
@@ -161,155 +245,148 @@ void keyboard(unsigned char key, int x, int y)
 	glutPostRedisplay();
 }
 
-std::vector<glm::vec2> sutherlandHodgman(const std::vector<glm::vec2>& polygon, glm::vec2 pMin, glm::vec2 pMax)
+/**
+ * Uploads triangles into an index buffer attached to the vertex array of
+ * a stream. Indices count from the first vertex of the stream's data.
+ */
+void uploadIndices(const StreamBuffer& stream, unsigned int& EBO, const std::vector<uint32_t>& indices)
 {
-    enum Edge { LEFT, RIGHT, BOTTOM, TOP };
-
-    auto inside = [&](const glm::vec2& p, Edge edge) -> bool {
-        switch (edge) {
-            case LEFT:   return p.x >= pMin.x;
-            case RIGHT:  return p.x <= pMax.x;
-            case BOTTOM: return p.y >= pMin.y;
-            case TOP:    return p.y <= pMax.y;
-        }
-        return false;
-    };
-
-    auto intersection = [&](const glm::vec2& p1, const glm::vec2& p2, Edge edge) -> glm::vec2 {
-        float x, y;
-        float dx = p2.x - p1.x;
-        float dy = p2.y - p1.y;
-
-        switch (edge) {
-            case LEFT:
-                x = pMin.x;
-                y = p1.y + dy * (pMin.x - p1.x) / dx;
-                break;
-            case RIGHT:
-                x = pMax.x;
-                y = p1.y + dy * (pMax.x - p1.x) / dx;
-                break;
-            case BOTTOM:
-                y = pMin.y;
-                x = p1.x + dx * (pMin.y - p1.y) / dy;
-                break;
-            case TOP:
-                y = pMax.y;
-                x = p1.x + dx * (pMax.y - p1.y) / dy;
-                break;
-        }
-        return glm::vec2(x, y);
-    };
-
-    auto clipPolygon = [&](const std::vector<glm::vec2>& input, Edge edge) -> std::vector<glm::vec2> {
-        std::vector<glm::vec2> output;
-        if (input.empty()) return output;
-
-        glm::vec2 S = input.back();
-
-        for (const glm::vec2& E : input) {
-            if ( !inside(S, edge) && inside(E, edge)) {
-                output.push_back(intersection(S, E, edge));                
-            } else if (inside(S, edge) && inside(E, edge) ) {
-                output.push_back(S);
-            }else if (inside(S, edge) && !inside(E, edge)){
-                output.push_back(S);
-                output.push_back(intersection(S, E, edge));
-            } else if (!inside(S, edge) && !inside(E, edge)) {
-                // Do nothing, both points are outside
-            }
-            S = E;
-        }
-
-        return output;
-    };
-
-    std::vector<glm::vec2> output = polygon;
-
-    for (Edge edge : {LEFT, RIGHT, BOTTOM, TOP}) {
-        output = clipPolygon(output, edge);
-        if (output.empty()) break;
-    }
-
-    return output;
+    stream.bind();
+    if (EBO == 0) glGenBuffers(1, &EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
 }
 
-
-
-void initDataFromRectangle(glm::vec2 p1, glm::vec2 p2)
+void initDataFromPolygon(const std::vector<glm::vec2>& points)
 {
-    float z = 0.0f;  // profundidade fixa
+    polygonStream.upload(points.data(), points.size());
 
-    float vertices[] = {
-        p1.x, p1.y, z,  // Bottom-left
-        p2.x, p1.y, z,  // Bottom-right
-        p2.x, p2.y, z,  // Top-right
-        p1.x, p2.y, z   // Top-left
-    };
+    // A fan is only right for convex polygons; draw the triangulation.
+    const std::vector<uint32_t>& indices = polygonTriangles.get(points.data(), points.size());
+    if (polygonTriangles.changed())
+        uploadIndices(polygonStream, EBOpolygon, indices);
+    polygonIndexCount = indices.size();
+}
 
-    if (VAOretangle == 0) glGenVertexArrays(1, &VAOretangle);
-    if (VBOretangle == 0) glGenBuffers(1, &VBOretangle);
+void initDataFromPolygonClipped(const std::vector<glm::vec2>& points, const std::vector<uint32_t>& indices)
+{
+    clippedStream.upload(points.data(), points.size());
+    uploadIndices(clippedStream, EBOclipped, indices);
+    clippedIndexCount = indices.size();
+}
 
-    glBindVertexArray(VAOretangle);
-    glBindBuffer(GL_ARRAY_BUFFER, VBOretangle);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    glBindVertexArray(0);
+/** Appends the clip of polygon edge (p, q) to previewClipped. */
+void clipPreviewEdge(glm::vec2 p, glm::vec2 q)
+{
+    glm::vec2 run[CLIP_EDGE_MAX_POINTS];
+    size_t k = clipEdgeToRectangle(p, q, glm::min(points[0], points[1]), glm::max(points[0], points[1]), run);
+    previewClipped.insert(previewClipped.end(), run, run + k);
 }
 
-void initDataFromPolygon(const std::vector<glm::vec2>& points)
+/**
+ * Appends a vertex to the polygon being drawn and updates the preview.
+ *
+ * Only the edges that changed are clipped again: the run of the old
+ * closing edge, at the end of previewClipped, is replaced by the runs of
+ * the new edge and of the new closing edge, and only that tail of both
+ * streams is written from the CPU. A click costs the same for any polygon size.
+ */
+void appendPolygonVertex(glm::vec2 p)
 {
-    std::vector<float> vertices;
-    float z = 0.0f;
+    polygonPoints.push_back(p);
+    size_t n = polygonPoints.size();
+    polygonStream.update(polygonPoints.data(), n, n - 1);
+
+    if (!previewValid) return;
+
+    size_t first = previewClosing;
+    previewClipped.resize(first);
+    if (n > 1)
+        clipPreviewEdge(polygonPoints[n - 2], p);
+    previewClosing = previewClipped.size();
+    clipPreviewEdge(p, polygonPoints[0]);
+    clippedStream.update(previewClipped.data(), previewClipped.size(), first);
+}
 
-    for (const auto& p : points) {
-        vertices.push_back(p.x);
-        vertices.push_back(p.y);
-        vertices.push_back(z);
+/** Clips the whole polygon being drawn again, after the window changed. */
+void rebuildPreview()
+{
+    previewClipped.clear();
+    previewClosing = 0;
+    previewValid = windowIsRectangle && windowAngle == 0.0f;
+    if (!previewValid || polygonPoints.empty()) return;
+
+    size_t n = polygonPoints.size();
+    for (size_t i = 0; i < n; i++) {
+        if (i == n - 1) previewClosing = previewClipped.size();
+        clipPreviewEdge(polygonPoints[i], polygonPoints[(i + 1) % n]);
     }
+    clippedStream.upload(previewClipped.data(), previewClipped.size());
+}
 
-    if (VAOpolygon == 0) glGenVertexArrays(1, &VAOpolygon);
-    if (VBOpolygon == 0) glGenBuffers(1, &VBOpolygon);
 
-    glBindVertexArray(VAOpolygon);
-    glBindBuffer(GL_ARRAY_BUFFER, VBOpolygon);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+/**
+ * Rebuilds the clip window from the selection and re-clips the polygon.
+ */
+void updateWindow()
+{
+    if (windowIsRectangle)
+        windowPoints = rotatedRectangle(glm::min(points[0], points[1]), glm::max(points[0], points[1]),
+                                        glm::radians(windowAngle));
+    clipWindow.set(windowPoints);
+    windowStream.upload(windowPoints.data(), windowPoints.size());
+    if (draw_polygon)
+        clipPolygon();
+    else
+        rebuildPreview();
 }
 
-void initDataFromPolygonClipped(const std::vector<glm::vec2>& points)
+/**
+ * Clips the polygon against the window into clippedPolygon.
+ *
+ * Convex polygons against the unrotated rectangle use the rectangle
+ * clipper; anything else goes through clipToWindow, which splits concave
+ * results into separate pieces instead of joining them with bridges.
+ * Every piece is triangulated (through its cache) into one index buffer,
+ * so all pieces are drawn with a single call.
+ */
+void clipPolygon()
 {
-    std::vector<float> vertices;
-    float z = 0.0f;
-
-    for (const auto& p : points) {
-        vertices.push_back(p.x);
-        vertices.push_back(p.y);
-        vertices.push_back(z);
+    clippedPolygon.clear();
+    pieceFirst.clear();
+    pieceCount.clear();
+
+    if (windowIsRectangle && windowAngle == 0.0f && polygonIsConvex(polygonPoints.data(), polygonPoints.size())) {
+        ClipView clipped = sutherlandHodgmanTrivial(polygonPoints.data(), polygonPoints.size(),
+            glm::min(points[0], points[1]), glm::max(points[0], points[1]), clipScratch);
+        // Entirely outside: no piece, as clipToWindow does.
+        if (clipped.size >= 3) {
+            clippedPolygon.assign(clipped.points, clipped.points + clipped.size);
+            pieceFirst.push_back(0);
+            pieceCount.push_back(clipped.size);
+        }
+    } else {
+        std::vector<std::vector<glm::vec2>> pieces;
+        clipToWindow(polygonPoints, clipWindow, pieces);
+        for (const std::vector<glm::vec2>& piece : pieces) {
+            pieceFirst.push_back(clippedPolygon.size());
+            pieceCount.push_back(piece.size());
+            clippedPolygon.insert(clippedPolygon.end(), piece.begin(), piece.end());
+        }
     }
 
-    if (VAOclipped == 0) glGenVertexArrays(1, &VAOclipped);
-    if (VBOclipped == 0) glGenBuffers(1, &VBOclipped);
-
-    glBindVertexArray(VAOclipped);
-    glBindBuffer(GL_ARRAY_BUFFER, VBOclipped);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glBindVertexArray(0);
+    clippedIndices.clear();
+    pieceTriangles.resize(pieceFirst.size());
+    for (size_t i = 0; i < pieceFirst.size(); i++) {
+        const std::vector<uint32_t>& indices = pieceTriangles[i].get(clippedPolygon.data() + pieceFirst[i], pieceCount[i]);
+        for (uint32_t k : indices)
+            clippedIndices.push_back(pieceFirst[i] + k);
+    }
+    initDataFromPolygonClipped(clippedPolygon, clippedIndices);
 }
 
-
-
 glm::vec2 windowToNDC(int x, int y)
 {
     float ndc_x = (2.0f * x) / win_width - 1.0f;
@@ -328,27 +405,31 @@ void mouseCallback(int button, int state, int x, int y)
                 click_count++;
 
                 if (click_count == 2) {
-                    glm::vec2 p1 = glm::min(points[0], points[1]);
-                    glm::vec2 p2 = glm::max(points[0], points[1]);
-                    initDataFromRectangle(p1, p2);
+                    updateWindow();
                     
                     ready_to_draw = true;
                     mode = SELECT_POLYGON; // muda de modo após o retângulo
                 }
             }
+        } else if (mode == SELECT_WINDOW) {
+            windowPoints.push_back(ndc);
+            windowStream.upload(windowPoints.data(), windowPoints.size());
         } else if (mode == SELECT_POLYGON && !draw_polygon) {
-            polygonPoints.push_back(ndc);
+            appendPolygonVertex(ndc);
         }
 
         glutPostRedisplay();
     }
 
     if (button == GLUT_RIGHT_BUTTON && state == GLUT_DOWN) {
-        if (mode == SELECT_POLYGON && polygonPoints.size() >= 3) {
+        if (mode == SELECT_WINDOW && windowPoints.size() >= 3) {
+            ready_to_draw = true;
+            mode = SELECT_POLYGON;
+            updateWindow();
+        } else if (mode == SELECT_POLYGON && polygonPoints.size() >= 3) {
             initDataFromPolygon(polygonPoints);
-            clippedPolygon = sutherlandHodgman(polygonPoints, glm::min(points[0], points[1]), glm::max(points[0], points[1]));
-            initDataFromPolygonClipped(clippedPolygon);
             draw_polygon = true;
+            clipPolygon();
         }
         glutPostRedisplay();
     }
@@ -362,6 +443,11 @@ void initShaders()
 {
     // Request a program and shader slots from GPU
     program = createShaderProgram(vertex_code, fragment_code);
+    uniforms.init(program, {"model", "view", "projection", "color"});
+
+    model = glm::mat4(1.0f);
+    view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
+    projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
 }
 
 int main(int argc, char** argv)
@@ -369,7 +455,7 @@ int main(int argc, char** argv)
 	glutInit(&argc, argv);
 	glutInitContextVersion(3, 3);
 	glutInitContextProfile(GLUT_CORE_PROFILE);
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH | GLUT_STENCIL);
 	glutInitWindowSize(win_width,win_height);
 	glutCreateWindow(argv[0]);
 	glewInit();
@@ -15,6 +15,11 @@
 #include <glm/gtx/string_cast.hpp>
 #include "../lib/utils.h"
 #include <vector>
+#include <string.h>
+#include <algorithm>
+#include "raster.h"
+#include "frame_stats.h"
+#include "program_cache.h"
 
 
 /* Globals */
@@ -30,21 +35,116 @@ unsigned int VAO;
 /** Vertex buffer object. */
 unsigned int VBO;
 
+/** Uniform slots of the program. */
+enum Uniform { U_MODEL, U_VIEW, U_PROJECTION, U_VIEWPORT };
+/** Cached uniform locations and values. */
+ProgramCache uniforms;
+/** Transforms, recomputed only when they change. */
+glm::mat4 model, view, projection;
+
+
+/** Drawing mode: points rasterized on the CPU or generated on the GPU. */
+enum Mode { CPU_POINTS, GPU_INSTANCED };
+Mode mode = CPU_POINTS;
+
+/** Program generating the points from per-circle instances. */
+int programInstanced;
+/** Uniform slots of the instanced program. */
+enum InstancedUniform { UI_VIEWPORT };
+ProgramCache instancedUniforms;
+/** Vertex array and buffer holding one (xc, yc, r) per circle. */
+unsigned int VAOinstanced, VBOinstanced;
+
+/**
+ * Largest radius of the instanced mode: its shader computes 4(r^2 - x^2)
+ * and squares values up to 2r in 32-bit ints, so 4r^2 must fit in an int.
+ */
+const int GPU_MAX_RADIUS = 23170;
+/** False if some circle is larger than GPU_MAX_RADIUS; the instanced mode is then off. */
+bool gpuAvailable = true;
+
+/** Circles drawn, in pixels. */
+std::vector<Circle> circles;
+/** Largest number of points of a single circle. */
+size_t maxCirclePoints = 0;
+
+/** Frame instrumentation, enabled with --stats [file.csv]. */
+FrameStats* frameStats = NULL;
+/** CSV written on exit when instrumentation is enabled. */
+const char* statsPath = "frame_stats.csv";
 
 /** Vertex shader. */
 const char *vertex_code = "\n"
 "#version 330 core\n"
-"layout (location = 0) in vec3 position;\n"
+"layout (location = 0) in ivec2 position;\n"
 "\n"
 "uniform mat4 model;\n"
 "uniform mat4 view;\n"
 "uniform mat4 projection;\n"
+"uniform vec2 viewport;\n"
 "\n"
 "void main()\n"
 "{\n"
-"    gl_Position = vec4(position, 1.0);\n"
+"    // Pixel -> NDC, com o eixo y invertido.\n"
+"    vec2 ndc = vec2(2.0 * position.x / viewport.x - 1.0, 1.0 - 2.0 * position.y / viewport.y);\n"
+"    gl_Position = vec4(ndc, 0.0, 1.0);\n"
 "}\0";
 
+/**
+ * Vertex shader of the instanced mode.
+ *
+ * Each instance is a circle and each vertex one point of bresenhamCircle:
+ * step k = gl_VertexID / 8 of the first octant, mirrored to octant
+ * gl_VertexID % 8. y at step k comes from the closed form of the decision
+ * variable, the largest y with (2y-1)^2 <= 4(r^2-k^2) (see raster.cpp).
+ * Vertices past the end of a smaller circle are moved outside the clip
+ * volume. 32-bit ints limit radii to GPU_MAX_RADIUS; initData turns the
+ * mode off for larger circles.
+ */
+const char *vertex_code_instanced = R"(
+#version 330 core
+layout (location = 1) in ivec3 circle;
+
+uniform vec2 viewport;
+
+int bresenhamY(int x, int r)
+{
+    if (x == 0) return r;
+    int m = 4 * (r * r - x * x);
+    if (m <= 0) return 0;
+    int s = int(sqrt(float(m)));
+    if (s * s > m) s--;
+    if ((s + 1) * (s + 1) <= m) s++;
+    return (s + 1) / 2;
+}
+
+void main()
+{
+    int x = gl_VertexID / 8;
+    int y = bresenhamY(x, circle.z);
+    if (x > y) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    ivec2 p;
+    switch (gl_VertexID % 8) {
+        case 0: p = ivec2( x,  y); break;
+        case 1: p = ivec2(-x,  y); break;
+        case 2: p = ivec2( x, -y); break;
+        case 3: p = ivec2(-x, -y); break;
+        case 4: p = ivec2( y,  x); break;
+        case 5: p = ivec2(-y,  x); break;
+        case 6: p = ivec2( y, -x); break;
+        default: p = ivec2(-y, -x); break;
+    }
+    p += circle.xy;
+
+    vec2 ndc = vec2(2.0 * p.x / viewport.x - 1.0, 1.0 - 2.0 * p.y / viewport.y);
+    gl_Position = vec4(ndc, 0.0, 1.0);
+}
+)";
+
 /** Fragment shader. */
 const char *fragment_code = "\n"
 "#version 330 core\n"
@@ -68,82 +168,127 @@ void initShaders(void);
  *
  * Draws primitive.
  */
- std::vector<glm::vec3> circlePoints;
-
-void bresenhamCircle(int xc, int yc, int r) {
-    int x = 0, y = r;
-    int d = 3 - 2 * r;
-
-    auto plotCirclePoints = [&](int x, int y) {
-        circlePoints.push_back(glm::vec3(xc + x, yc + y, 0.0f));
-        circlePoints.push_back(glm::vec3(xc - x, yc + y, 0.0f));
-        circlePoints.push_back(glm::vec3(xc + x, yc - y, 0.0f));
-        circlePoints.push_back(glm::vec3(xc - x, yc - y, 0.0f));
-        circlePoints.push_back(glm::vec3(xc + y, yc + x, 0.0f));
-        circlePoints.push_back(glm::vec3(xc - y, yc + x, 0.0f));
-        circlePoints.push_back(glm::vec3(xc + y, yc - x, 0.0f));
-        circlePoints.push_back(glm::vec3(xc - y, yc - x, 0.0f));
-    };
-
-    while (x <= y) {
-        plotCirclePoints(x, y);
-        if (d < 0)
-            d = d + 4 * x + 6;
-        else {
-            d = d + 4 * (x - y) + 10;
-            y--;
-        }
-        x++;
-    }
-}
+ /** Circle points as interleaved (x, y) pixel coordinates; only one is used. */
+ std::vector<int16_t> circlePixels16;
+ std::vector<int32_t> circlePixels32;
+ /** Number of circle points. */
+ size_t circlePointCount = 0;
+
 void printCirclePoints() {
     std::cout << "Pontos do círculo (x, y):" << std::endl;
-    for (const auto& p : circlePoints) {
-        std::cout << "(" << p.x << ", " << p.y << ")" << std::endl;
+    for (size_t i = 0; i < circlePointCount; i++) {
+        int x = circlePixels16.empty() ? circlePixels32[2 * i] : circlePixels16[2 * i];
+        int y = circlePixels16.empty() ? circlePixels32[2 * i + 1] : circlePixels16[2 * i + 1];
+        std::cout << "(" << x << ", " << y << ")" << std::endl;
     }
     
-     std::cout << "quantidades de pontos do círculo (x, y):" << circlePoints.size() << std::endl;
+     std::cout << "quantidades de pontos do círculo (x, y):" << circlePointCount << std::endl;
 }
 
-std::vector<glm::vec3> toNDC(const std::vector<glm::vec3>& points, int width, int height) {
-    std::vector<glm::vec3> ndcPoints;
-    for (const auto& p : points) {
-        float x_ndc = (2.0f * p.x) / width - 1.0f;
-        float y_ndc = 1.0f - (2.0f * p.y) / height; // inverte Y para OpenGL
-        ndcPoints.push_back(glm::vec3(x_ndc, y_ndc, 0.0f));
-    }
-    return ndcPoints;
+ 
+/** Shows the mean of the last frames in the window title. */
+void updateStatsTitle()
+{
+    if (frameStats->frameCount() % 30 != 0) return;
+
+    FrameSample m = frameStats->mean(30);
+    char title[128];
+    snprintf(title, sizeof(title), "cpu %.3f ms | gl %.3f ms | frame %.2f ms | %zu points",
+             m.cpuMs, m.gpuMs, m.frameMs, m.points);
+    glutSetWindowTitle(title);
 }
 
- 
-void display()
+/** Draws the circles with the current mode. */
+void drawCircles()
 {
-        std::cout << "Cheguei no display"  << std::endl;
-        
-        printCirclePoints();
     	glClearColor(0.2, 0.3, 0.3, 1.0); 
     	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    	glUseProgram(program);
-    	glBindVertexArray(VAO);
+        if (mode == CPU_POINTS) {
+            uniforms.use();
+            glBindVertexArray(VAO);
 
-	glm::mat4 Rx = glm::rotate(glm::mat4(1.0f), glm::radians(10.0f), glm::vec3(1.0f,0.0f,0.0f));
-	glm::mat4 Ry = glm::rotate(glm::mat4(1.0f), glm::radians(-30.0f), glm::vec3(0.0f,1.0f,0.0f));
-	glm::mat4 model = Rx*Ry;
-	unsigned int loc = glGetUniformLocation(program, "model");
-	glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(model));
-	
-	glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f,0.0f,-5.0f));
-	loc = glGetUniformLocation(program, "view");
-	glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(view));
+            uniforms.setMat4(U_MODEL, model);
+            uniforms.setMat4(U_VIEW, view);
+            uniforms.setMat4(U_PROJECTION, projection);
+            uniforms.setVec2(U_VIEWPORT, glm::vec2(win_width, win_height));
+
+            glPointSize(4.0); // Tamanho visível dos pontos
+            glDrawArrays(GL_POINTS, 0, circlePointCount);
+        } else {
+            instancedUniforms.use();
+            glBindVertexArray(VAOinstanced);
+
+            instancedUniforms.setVec2(UI_VIEWPORT, glm::vec2(win_width, win_height));
+
+            glPointSize(4.0);
+            glDrawArraysInstanced(GL_POINTS, 0, maxCirclePoints, circles.size());
+        }
+}
+
+/**
+ * Renders both modes offscreen and counts the pixels that differ.
+ *
+ * Run with LIBGL_ALWAYS_SOFTWARE=1 to check against Mesa's software
+ * renderer.
+ *
+ * @param drawn Receives the pixels the CPU mode covered, so an empty
+ *        image cannot pass unnoticed.
+ * @return Number of different pixels.
+ */
+size_t compareModes(size_t& drawn)
+{
+    unsigned int fbo, rbo[2];
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(2, rbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbo[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, win_width, win_height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbo[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbo[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, win_width, win_height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo[1]);
+    glViewport(0, 0, win_width, win_height);
+
+    // Background as the clear of drawCircles leaves it.
+    unsigned char background[4];
+    glClearColor(0.2, 0.3, 0.3, 1.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glReadPixels(0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, background);
+
+    std::vector<unsigned char> image[2];
+    Mode modes[2] = { CPU_POINTS, GPU_INSTANCED };
+    for (int i = 0; i < 2; i++) {
+        mode = modes[i];
+        drawCircles();
+        image[i].resize(4 * win_width * win_height);
+        glReadPixels(0, 0, win_width, win_height, GL_RGBA, GL_UNSIGNED_BYTE, image[i].data());
+    }
+
+    size_t diff = 0;
+    drawn = 0;
+    for (size_t p = 0; p < image[0].size(); p += 4) {
+        if (memcmp(&image[0][p], &image[1][p], 4) != 0) diff++;
+        if (memcmp(&image[0][p], background, 4) != 0) drawn++;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(2, rbo);
+    glDeleteFramebuffers(1, &fbo);
+    mode = CPU_POINTS;
+    return diff;
+}
 
-	glm::mat4 projection = glm::perspective(glm::radians(45.0f), (win_width/(float)win_height), 0.1f, 100.0f);
- 	loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(projection));
+void display()
+{
+        if (frameStats) frameStats->beginFrame();
 
-    	glPointSize(4.0); // Tamanho visível dos pontos
-        glDrawArrays(GL_POINTS, 0, circlePoints.size());
+        drawCircles();
 
+        if (frameStats) {
+            frameStats->endFrame(circlePointCount);
+            updateStatsTitle();
+        }
 
     	glutSwapBuffers();
 }
@@ -161,6 +306,7 @@ void reshape(int width, int height)
     win_width = width;
     win_height = height;
     glViewport(0, 0, width, height);
+    projection = glm::perspective(glm::radians(45.0f), (win_width/(float)win_height), 0.1f, 100.0f);
     glutPostRedisplay();
 }
 
@@ -178,6 +324,14 @@ void keyboard(unsigned char key, int x, int y)
 {
         switch (key)
         {
+                case 'p':
+                case 'P':
+                        printCirclePoints();
+                        break;
+                case 'g':
+                case 'G':
+                        if (gpuAvailable) mode = mode == CPU_POINTS ? GPU_INSTANCED : CPU_POINTS;
+                        break;
                 case 27:
                         glutLeaveMainLoop();
                 case 'q':
@@ -196,20 +350,50 @@ void keyboard(unsigned char key, int x, int y)
  */
 void initData()
 {
-    // Gera os pontos do círculo (com centro em 0,0 e raio 100)
-    bresenhamCircle(0, 0, 100);
-    circlePoints = toNDC(circlePoints, win_width, win_height); 
+    // Os pontos ficam em pixels; a conversão para NDC é feita no vertex shader.
+    // Cada pixel é enviado uma vez só (sem as repetições de x == 0 e x == y).
+    circlePointCount = bresenhamCirclesUniquePointCount(circles.data(), circles.size());
     
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
 
     glGenBuffers(1, &VBO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, circlePoints.size() * sizeof(glm::vec3), &circlePoints[0], GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    if (circlesFitInt16(circles.data(), circles.size())) {
+        circlePixels16.resize(2 * circlePointCount);
+        bresenhamCirclesPixelsUnique(circles.data(), circles.size(), circlePixels16.data());
+        glBufferData(GL_ARRAY_BUFFER, circlePixels16.size() * sizeof(int16_t), circlePixels16.data(), GL_STATIC_DRAW);
+        glVertexAttribIPointer(0, 2, GL_SHORT, 2 * sizeof(int16_t), (void*)0);
+    } else {
+        circlePixels32.resize(2 * circlePointCount);
+        bresenhamCirclesPixelsUnique(circles.data(), circles.size(), circlePixels32.data());
+        glBufferData(GL_ARRAY_BUFFER, circlePixels32.size() * sizeof(int32_t), circlePixels32.data(), GL_STATIC_DRAW);
+        glVertexAttribIPointer(0, 2, GL_INT, 2 * sizeof(int32_t), (void*)0);
+    }
     glEnableVertexAttribArray(0);
 
+    // Modo instanciado: só (xc, yc, r) por círculo; os pontos saem do shader.
+    maxCirclePoints = 0;
+    for (const Circle& c : circles) {
+        maxCirclePoints = std::max(maxCirclePoints, bresenhamCirclePointCount(c.r));
+        if (c.r > GPU_MAX_RADIUS) gpuAvailable = false;
+    }
+    if (!gpuAvailable) {
+        fprintf(stderr, "radius above %d: GPU mode disabled\n", GPU_MAX_RADIUS);
+        mode = CPU_POINTS;
+    }
+
+    glGenVertexArrays(1, &VAOinstanced);
+    glBindVertexArray(VAOinstanced);
+
+    glGenBuffers(1, &VBOinstanced);
+    glBindBuffer(GL_ARRAY_BUFFER, VBOinstanced);
+    glBufferData(GL_ARRAY_BUFFER, circles.size() * sizeof(Circle), circles.data(), GL_STATIC_DRAW);
+    glVertexAttribIPointer(1, 3, GL_INT, sizeof(Circle), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(1);
+
     glBindVertexArray(0);
 
     glEnable(GL_PROGRAM_POINT_SIZE); // Permite mudar tamanho dos pontos
@@ -224,6 +408,16 @@ void initShaders()
 {
     // Request a program and shader slots from GPU
     program = createShaderProgram(vertex_code, fragment_code);
+    uniforms.init(program, {"model", "view", "projection", "viewport"});
+
+    programInstanced = createShaderProgram(vertex_code_instanced, fragment_code);
+    instancedUniforms.init(programInstanced, {"viewport"});
+
+    glm::mat4 Rx = glm::rotate(glm::mat4(1.0f), glm::radians(10.0f), glm::vec3(1.0f,0.0f,0.0f));
+    glm::mat4 Ry = glm::rotate(glm::mat4(1.0f), glm::radians(-30.0f), glm::vec3(0.0f,1.0f,0.0f));
+    model = Rx*Ry;
+    view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f,0.0f,-5.0f));
+    projection = glm::perspective(glm::radians(45.0f), (win_width/(float)win_height), 0.1f, 100.0f);
 }
 
 int main(int argc, char** argv)
@@ -236,15 +430,60 @@ int main(int argc, char** argv)
 	glutCreateWindow(argv[0]);
 	glewInit();
 
+	// Opções: --stats [arquivo.csv], --circles N, --gpu, --compare
+	bool compare = false;
+	int randomCircles = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--stats") == 0) {
+			frameStats = new FrameStats();
+			if (i + 1 < argc && argv[i + 1][0] != '-') statsPath = argv[++i];
+		} else if (strcmp(argv[i], "--circles") == 0 && i + 1 < argc) {
+			randomCircles = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--gpu") == 0) {
+			mode = GPU_INSTANCED;
+		} else if (strcmp(argv[i], "--compare") == 0) {
+			compare = true;
+		}
+	}
+
+	// Círculo com centro em 0,0 e raio 100, ou N círculos aleatórios.
+	if (randomCircles > 0) {
+		srand(42);
+		for (int i = 0; i < randomCircles; i++)
+			circles.push_back(Circle{rand() % win_width, rand() % win_height, 1 + rand() % 64});
+	} else {
+		circles.push_back(Circle{0, 0, 100});
+	}
+
     	// Init vertex data for the triangle.
     	initData();
     
     	// Create shaders.
     	initShaders();
+
+	if (compare) {
+		if (!gpuAvailable) return 1;
+		size_t drawn;
+		size_t diff = compareModes(drawn);
+		printf("CPU x GPU: %zu pixels differ, %zu pixels drawn\n", diff, drawn);
+		return diff == 0 && drawn > 0 ? 0 : 1;
+	}
 	
     	glutReshapeFunc(reshape);
     	glutDisplayFunc(display);
     	glutKeyboardFunc(keyboard);
 
+	if (frameStats) {
+		// Redraw continuously and return from the main loop to dump the CSV.
+		glutIdleFunc(glutPostRedisplay);
+		glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+	}
+
 	glutMainLoop();
+
+	if (frameStats) {
+		frameStats->finish();
+		frameStats->writeCSV(statsPath);
+		delete frameStats;
+	}
 }
\ No newline at end of file
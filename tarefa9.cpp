@@ -6,12 +6,25 @@
  */
 
 #include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "../lib/utils.h"
+#include "program_cache.h"
+#include "mesh_buffer.h"
+#include "frame_stats.h"
+#include "texture_loader.h"
+#include "atlas.h"
+#include "instances.h"
+#include "thread_pool.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -21,9 +34,67 @@ int win_width  = 600;
 int win_height = 600;
 
 int program;
-unsigned int VAO, VBO;
+MeshBuffer mesh;
 unsigned int texture;
 
+/** Upload the mesh indexed and packed (false: 36 float vertices, as before). */
+bool compactMesh = true;
+/** If > 0, draw a generated sphere with this many slices instead of the cube. */
+int sphereSlices = 0;
+
+/** Frame timing, only with --stats. */
+FrameStats* frameStats = NULL;
+const char* statsPath = "frame_stats.csv";
+
+/** Background texture loading; NULL with --sync, which loads before the first frame. */
+TextureLoader* textureLoader = NULL;
+/** Copies of the texture to load, to time startup with many textures. */
+int textureCount = 1;
+/** Decoding threads of textureLoader (0: one per core). */
+unsigned decoderThreads = 0;
+/** Cooked texture to load instead of container.jpg (see texture_cooker). */
+const char* cookedPath = NULL;
+
+/** With --sprites N: N small cubes, each with its own generated texture. */
+int spriteCount = 0;
+/** Draw the sprites from one texture array in one call (false: one texture and draw each). */
+bool useAtlas = false;
+std::vector<glm::mat4> spriteModels;
+std::vector<unsigned int> spriteTextures;
+/** Layer size and gutter of the atlas. */
+const int ATLAS_SIZE = 1024, ATLAS_PADDING = 4;
+unsigned int atlasTexture, atlasVAO, atlasVBO;
+size_t atlasVertices = 0;
+int atlasProgram;
+ProgramCache atlasUniforms;
+/** GL calls of the last frame. */
+size_t drawCalls = 0, textureBinds = 0;
+
+/** With --cubes N: N spinning cubes, drawn with one instanced call. */
+size_t cubeCount = 0;
+CubeField cubeField;
+/** Rows of each cube's model matrix, rewritten every frame. */
+unsigned int instanceVBO = 0;
+int instanceProgram;
+ProgramCache instanceUniforms;
+/** Threads of the transform update. */
+ThreadPool* updatePool = NULL;
+/** Time of the last transform update. */
+double updateMs = 0.0;
+/** With --cube-bench: frames timed per cube count, then exit. */
+int cubeBenchFrames = 0;
+
+/** Startup timing: from the start of main to the first frame and to the last texture. */
+std::chrono::steady_clock::time_point startTime;
+bool firstFrameShown = false, texturesReported = false;
+
+/** Uniform slots of the program. */
+enum Uniform { U_MODEL, U_VIEW, U_PROJECTION };
+ProgramCache uniforms;
+
+/** Transforms, recomputed only when they change. */
+glm::mat4 model, view, projection;
+
 /** Vertex shader */
 const char *vertex_code = R"(
 #version 330 core
@@ -59,35 +130,195 @@ void main()
 }
 )";
 
+/** Vertex shader of the atlas: pre-transformed cubes, UVs with a layer. */
+const char *atlas_vertex_code = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec3 aTexCoord;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 TexCoord;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    TexCoord = aTexCoord;
+}
+)";
+
+/** Fragment shader of the atlas */
+const char *atlas_fragment_code = R"(
+#version 330 core
+out vec4 FragColor;
+
+in vec3 TexCoord;
+
+uniform sampler2DArray ourTexture;
+
+void main()
+{
+    FragColor = texture(ourTexture, TexCoord);
+}
+)";
+
+/** Vertex shader of the instanced cubes: model matrix rows per instance. */
+const char *instance_vertex_code = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 row0;
+layout (location = 4) in vec4 row1;
+layout (location = 5) in vec4 row2;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec2 TexCoord;
+
+void main()
+{
+    vec4 p = vec4(aPos, 1.0);
+    gl_Position = projection * view * vec4(dot(row0, p), dot(row1, p), dot(row2, p), 1.0);
+    TexCoord = aTexCoord;
+}
+)";
+
 void display();
 void reshape(int, int);
 void keyboard(unsigned char, int, int);
 void initData();
 void initShaders();
 
+/** Shows the mean of the last frames in the window title. */
+void updateStatsTitle()
+{
+    if (frameStats->frameCount() % 30 != 0) return;
+
+    FrameSample m = frameStats->mean(30);
+    char title[128];
+    snprintf(title, sizeof(title), "cpu %.3f ms | gl %.3f ms | frame %.2f ms | %zu draws | %zu binds",
+             m.cpuMs, m.gpuMs, m.frameMs, drawCalls, textureBinds);
+    glutSetWindowTitle(title);
+}
+
+/** Milliseconds since the start of main. */
+double msSinceStart()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+/** Prints the time to the first frame and to the last texture, once each. */
+void reportStartup()
+{
+    if (!firstFrameShown) {
+        firstFrameShown = true;
+        printf("first frame after %.1f ms\n", msSinceStart());
+    }
+    if (!texturesReported && (!textureLoader || textureLoader->pending() == 0)) {
+        texturesReported = true;
+        printf("%d textures resident after %.1f ms (%s)\n", textureCount, msSinceStart(),
+               textureLoader ? "background" : cookedPath ? "cooked, before the first frame"
+                                            : "loaded before the first frame");
+    }
+}
+
+/** Draws the sprite cubes, one draw each or all at once from the atlas. */
+void drawSprites()
+{
+    drawCalls = textureBinds = 0;
+
+    if (useAtlas) {
+        atlasUniforms.use();
+        atlasUniforms.setMat4(U_MODEL, glm::mat4(1.0f));
+        atlasUniforms.setMat4(U_VIEW, view);
+        atlasUniforms.setMat4(U_PROJECTION, projection);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, atlasTexture);
+        glBindVertexArray(atlasVAO);
+        glDrawArrays(GL_TRIANGLES, 0, (GLsizei)atlasVertices);
+        drawCalls = textureBinds = 1;
+        return;
+    }
+
+    uniforms.use();
+    uniforms.setMat4(U_VIEW, view);
+    uniforms.setMat4(U_PROJECTION, projection);
+    for (int i = 0; i < spriteCount; i++) {
+        uniforms.setMat4(U_MODEL, spriteModels[i]);
+        glBindTexture(GL_TEXTURE_2D, spriteTextures[i]);
+        mesh.draw();
+    }
+    drawCalls = textureBinds = spriteCount;
+}
+
+/**
+ * Rewrites the transforms of the cubes straight into the instance buffer,
+ * on all threads, and draws them in one call. The buffer is invalidated
+ * first, so the driver can hand out fresh memory instead of waiting for
+ * the previous frame's draw.
+ */
+void drawCubes()
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    float* rows = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, cubeCount * INSTANCE_FLOATS * sizeof(float),
+                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (rows) {
+        updateInstances(cubeField, (float)(msSinceStart() * 1e-3), rows, *updatePool);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    updateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    instanceUniforms.use();
+    instanceUniforms.setMat4(U_VIEW, view);
+    instanceUniforms.setMat4(U_PROJECTION, projection);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    mesh.drawInstanced(cubeCount);
+    drawCalls = textureBinds = 1;
+}
+
 /** Drawing function */
 void display()
 {
+    if (frameStats) frameStats->beginFrame();
+
+    if (textureLoader) {
+        textureLoader->update();
+        texture = textureLoader->texture(0);
+    }
+
     glClearColor(0.2, 0.3, 0.3, 1.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glUseProgram(program);
-    glBindVertexArray(VAO);
+    if (cubeCount > 0) {
+        drawCubes();
+    } else if (spriteCount > 0) {
+        drawSprites();
+    } else {
+        uniforms.use();
 
-    glm::mat4 Rx = glm::rotate(glm::mat4(1.0f), glm::radians(10.0f), glm::vec3(1.0f,0.0f,0.0f));
-    glm::mat4 Ry = glm::rotate(glm::mat4(1.0f), glm::radians(-30.0f), glm::vec3(0.0f,1.0f,0.0f));
-    glm::mat4 model = Rx * Ry;
-    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f,0.0f,-5.0f));
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)win_width/win_height, 0.1f, 100.0f);
+        uniforms.setMat4(U_MODEL, model);
+        uniforms.setMat4(U_VIEW, view);
+        uniforms.setMat4(U_PROJECTION, projection);
 
-    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        glBindTexture(GL_TEXTURE_2D, texture);
+        mesh.draw();
+        drawCalls = textureBinds = 1;
+    }
 
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    if (frameStats) {
+        frameStats->endFrame(cubeCount > 0 ? cubeCount : mesh.vertexCount());
+        updateStatsTitle();
+    }
 
     glutSwapBuffers();
+
+    reportStartup();
+    if (textureLoader && textureLoader->pending() > 0)
+        glutPostRedisplay();
 }
 
 void reshape(int width, int height)
@@ -95,91 +326,76 @@ void reshape(int width, int height)
     win_width = width;
     win_height = height;
     glViewport(0, 0, width, height);
+    projection = glm::perspective(glm::radians(45.0f), (float)win_width/win_height, 0.1f, 100.0f);
     glutPostRedisplay();
 }
 
 void keyboard(unsigned char key, int x, int y)
 {
-    if (key == 27 || key == 'q' || key == 'Q') {
+    if (key == 27 || key == 'q' || key == 'Q')
         glutLeaveMainLoop();
-    }
     glutPostRedisplay();
 }
 
-void initData()
-{
-    float vertices[] = {
-    // positions          // colors           // texture coords
+/** Cube as a triangle list, 6 vertices per face. */
+const MeshVertex cube[] = {
+    // position                  normal        texture coords
     // Front face
-    -0.5f, -0.5f,  0.5f,  1, 0, 0,  0.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,  0, 1, 0,  1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  0, 0, 1,  1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  0, 0, 1,  1.0f, 1.0f,
-    -0.5f,  0.5f,  0.5f,  1, 1, 0,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  1, 0, 0,  0.0f, 0.0f,
+    {{-0.5f, -0.5f,  0.5f}, { 0,  0,  1}, {0.0f, 0.0f}},
+    {{ 0.5f, -0.5f,  0.5f}, { 0,  0,  1}, {1.0f, 0.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, { 0,  0,  1}, {1.0f, 1.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, { 0,  0,  1}, {1.0f, 1.0f}},
+    {{-0.5f,  0.5f,  0.5f}, { 0,  0,  1}, {0.0f, 1.0f}},
+    {{-0.5f, -0.5f,  0.5f}, { 0,  0,  1}, {0.0f, 0.0f}},
 
     // Back face
-    -0.5f, -0.5f, -0.5f,  1, 0, 1,  0.0f, 0.0f,
-     0.5f, -0.5f, -0.5f,  0, 1, 1,  1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,  0, 0, 0,  1.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,  0, 0, 0,  1.0f, 1.0f,
-    -0.5f,  0.5f, -0.5f,  1, 1, 1,  0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  1, 0, 1,  0.0f, 0.0f,
+    {{-0.5f, -0.5f, -0.5f}, { 0,  0, -1}, {0.0f, 0.0f}},
+    {{ 0.5f, -0.5f, -0.5f}, { 0,  0, -1}, {1.0f, 0.0f}},
+    {{ 0.5f,  0.5f, -0.5f}, { 0,  0, -1}, {1.0f, 1.0f}},
+    {{ 0.5f,  0.5f, -0.5f}, { 0,  0, -1}, {1.0f, 1.0f}},
+    {{-0.5f,  0.5f, -0.5f}, { 0,  0, -1}, {0.0f, 1.0f}},
+    {{-0.5f, -0.5f, -0.5f}, { 0,  0, -1}, {0.0f, 0.0f}},
 
     // Left face
-    -0.5f,  0.5f,  0.5f,  1, 1, 0,  1.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,  1, 0, 0,  1.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0, 1, 0,  0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0, 1, 0,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0, 0, 1,  0.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,  1, 1, 0,  1.0f, 0.0f,
+    {{-0.5f,  0.5f,  0.5f}, {-1,  0,  0}, {1.0f, 0.0f}},
+    {{-0.5f,  0.5f, -0.5f}, {-1,  0,  0}, {1.0f, 1.0f}},
+    {{-0.5f, -0.5f, -0.5f}, {-1,  0,  0}, {0.0f, 1.0f}},
+    {{-0.5f, -0.5f, -0.5f}, {-1,  0,  0}, {0.0f, 1.0f}},
+    {{-0.5f, -0.5f,  0.5f}, {-1,  0,  0}, {0.0f, 0.0f}},
+    {{-0.5f,  0.5f,  0.5f}, {-1,  0,  0}, {1.0f, 0.0f}},
 
     // Right face
-     0.5f,  0.5f,  0.5f,  1, 1, 1,  1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,  0, 1, 1,  1.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  1, 0, 1,  0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  1, 0, 1,  0.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,  1, 1, 0,  0.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1, 1, 1,  1.0f, 0.0f,
+    {{ 0.5f,  0.5f,  0.5f}, { 1,  0,  0}, {1.0f, 0.0f}},
+    {{ 0.5f,  0.5f, -0.5f}, { 1,  0,  0}, {1.0f, 1.0f}},
+    {{ 0.5f, -0.5f, -0.5f}, { 1,  0,  0}, {0.0f, 1.0f}},
+    {{ 0.5f, -0.5f, -0.5f}, { 1,  0,  0}, {0.0f, 1.0f}},
+    {{ 0.5f, -0.5f,  0.5f}, { 1,  0,  0}, {0.0f, 0.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, { 1,  0,  0}, {1.0f, 0.0f}},
 
     // Bottom face
-    -0.5f, -0.5f, -0.5f,  0, 0, 0,  0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  1, 0, 0,  1.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,  0, 1, 0,  1.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,  0, 1, 0,  1.0f, 0.0f,
-    -0.5f, -0.5f,  0.5f,  0, 0, 1,  0.0f, 0.0f,
-    -0.5f, -0.5f, -0.5f,  0, 0, 0,  0.0f, 1.0f,
+    {{-0.5f, -0.5f, -0.5f}, { 0, -1,  0}, {0.0f, 1.0f}},
+    {{ 0.5f, -0.5f, -0.5f}, { 0, -1,  0}, {1.0f, 1.0f}},
+    {{ 0.5f, -0.5f,  0.5f}, { 0, -1,  0}, {1.0f, 0.0f}},
+    {{ 0.5f, -0.5f,  0.5f}, { 0, -1,  0}, {1.0f, 0.0f}},
+    {{-0.5f, -0.5f,  0.5f}, { 0, -1,  0}, {0.0f, 0.0f}},
+    {{-0.5f, -0.5f, -0.5f}, { 0, -1,  0}, {0.0f, 1.0f}},
 
     // Top face
-    -0.5f,  0.5f, -0.5f,  1, 1, 0,  0.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,  0, 1, 1,  1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  1, 0, 1,  1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1, 0, 1,  1.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,  1, 1, 1,  0.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,  1, 1, 0,  0.0f, 1.0f
+    {{-0.5f,  0.5f, -0.5f}, { 0,  1,  0}, {0.0f, 1.0f}},
+    {{ 0.5f,  0.5f, -0.5f}, { 0,  1,  0}, {1.0f, 1.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, { 0,  1,  0}, {1.0f, 0.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, { 0,  1,  0}, {1.0f, 0.0f}},
+    {{-0.5f,  0.5f,  0.5f}, { 0,  1,  0}, {0.0f, 0.0f}},
+    {{-0.5f,  0.5f, -0.5f}, { 0,  1,  0}, {0.0f, 1.0f}}
 };
 
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glGenBuffers(1, &VBO);    
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture coord attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    // Gera e vincula a textura
+/** Loads a texture on the spot: decode, upload and mipmaps before returning. */
+unsigned int loadTextureSync(const char* path)
+{
     // Gera um identificador para a textura
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    unsigned int name;
+    glGenTextures(1, &name);
+    glBindTexture(GL_TEXTURE_2D, name);
 
     // Seta os parâmetros da textura
 
@@ -193,7 +409,7 @@ void initData()
 
     // Carrega a textura 
     int width, height, nrChannels;
-    unsigned char *data = stbi_load("container.jpg", &width, &height, &nrChannels, 0);
+    unsigned char *data = stbi_load(path, &width, &height, &nrChannels, 0);
     if (data)
     {
         GLenum format = nrChannels == 4 ? GL_RGBA : GL_RGB;
@@ -206,17 +422,200 @@ void initData()
     }
     stbi_image_free(data);
 
+    return name;
+}
+
+/** Checkerboard of two random colors, with squares of 1 to 8 pixels. */
+std::vector<unsigned char> spriteImage(int width, int height)
+{
+    unsigned char colors[2][3];
+    for (int c = 0; c < 6; c++)
+        colors[c / 3][c % 3] = rand() % 256;
+    int square = 1 + rand() % 8;
+
+    std::vector<unsigned char> pixels((size_t)width * height * 3);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            memcpy(&pixels[((size_t)y * width + x) * 3], colors[(x / square + y / square) % 2], 3);
+    return pixels;
+}
+
+/**
+ * Sprite scene: a grid of small cubes, each with its own texture of 8 to
+ * 64 pixels a side, as one GL_TEXTURE_2D each, or packed into an atlas
+ * with the cubes pre-transformed into one vertex buffer.
+ */
+void initSprites()
+{
+    srand(42);
+    int cols = (int)std::ceil(std::sqrt((double)spriteCount));
+    float spacing = 3.0f / cols;
+
+    std::vector<glm::ivec2> sizes(spriteCount);
+    std::vector<std::vector<unsigned char>> images(spriteCount);
+    spriteModels.resize(spriteCount);
+    for (int i = 0; i < spriteCount; i++) {
+        sizes[i] = glm::ivec2(8 + rand() % 57, 8 + rand() % 57);
+        images[i] = spriteImage(sizes[i].x, sizes[i].y);
+
+        glm::vec3 center(-1.5f + spacing * (i % cols + 0.5f), 1.5f - spacing * (i / cols + 0.5f), 0.0f);
+        spriteModels[i] = glm::scale(glm::translate(glm::mat4(1.0f), center) * model, glm::vec3(0.6f * spacing));
+    }
+
+    if (!useAtlas) {
+        spriteTextures.resize(spriteCount);
+        glGenTextures(spriteCount, spriteTextures.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int i = 0; i < spriteCount; i++) {
+            glBindTexture(GL_TEXTURE_2D, spriteTextures[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, sizes[i].x, sizes[i].y, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                         images[i].data());
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        printf("%d sprites: %d textures, %d draws and %d binds per frame\n", spriteCount, spriteCount,
+               spriteCount, spriteCount);
+        return;
+    }
+
+    std::vector<AtlasRect> rects;
+    int layers = packAtlas(sizes, ATLAS_SIZE, ATLAS_PADDING, rects);
+    std::vector<unsigned char> pixels((size_t)ATLAS_SIZE * ATLAS_SIZE * 3 * layers);
+    for (int i = 0; i < spriteCount; i++) {
+        const AtlasRect& r = rects[i];
+        blitToAtlas(&pixels[(size_t)r.layer * ATLAS_SIZE * ATLAS_SIZE * 3], ATLAS_SIZE, 3, images[i].data(), r,
+                    ATLAS_PADDING);
+    }
+    atlasTexture = uploadAtlas(pixels.data(), ATLAS_SIZE, layers, 3, ATLAS_PADDING);
+
+    // Cube vertices moved by each sprite's transform, UVs moved into its rectangle.
+    const size_t n = sizeof(cube) / sizeof(cube[0]);
+    std::vector<float> vertices;
+    vertices.reserve(spriteCount * n * 6);
+    for (int i = 0; i < spriteCount; i++) {
+        glm::vec4 uv = atlasUVTransform(rects[i], ATLAS_SIZE);
+        for (size_t v = 0; v < n; v++) {
+            glm::vec4 p = spriteModels[i] * glm::vec4(cube[v].position, 1.0f);
+            float vertex[6] = {p.x, p.y, p.z, cube[v].uv.x * uv.x + uv.z, cube[v].uv.y * uv.y + uv.w,
+                               (float)rects[i].layer};
+            vertices.insert(vertices.end(), vertex, vertex + 6);
+        }
+    }
+    atlasVertices = vertices.size() / 6;
+
+    glGenVertexArrays(1, &atlasVAO);
+    glBindVertexArray(atlasVAO);
+    glGenBuffers(1, &atlasVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, atlasVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
     glBindVertexArray(0);
+
+    printf("%d sprites: %d atlas layers of %d x %d, 1 draw and 1 bind per frame\n", spriteCount, layers,
+           ATLAS_SIZE, ATLAS_SIZE);
+}
+
+/** Replaces the cubes of the instanced scene with n new ones. */
+void initCubes(size_t n)
+{
+    cubeCount = n;
+    makeCubeField(n, 3.0f, glm::radians(10.0f), cubeField);
+
+    if (instanceVBO == 0) {
+        glGenBuffers(1, &instanceVBO);
+        mesh.instanceAttributes(instanceVBO, 3, 3);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, n * INSTANCE_FLOATS * sizeof(float), NULL, GL_STREAM_DRAW);
+}
+
+/**
+ * Frame time against the number of cubes: for 100 to 1e6 cubes, draws
+ * the given number of frames, each finished with glFinish, and prints
+ * the mean update and frame times. Runs on any GL 3.3 driver; for Mesa's
+ * software renderer, start with LIBGL_ALWAYS_SOFTWARE=1.
+ */
+void runCubeBench(int frames)
+{
+    printf("%s, %u update threads, %s path\n", (const char*)glGetString(GL_RENDERER), updatePool->size(),
+           instancePathName(instanceBestPath()));
+    printf("%8s %12s %12s %12s\n", "cubes", "update ms", "frame ms", "Mcubes/s");
+
+    for (size_t n = 100; n <= 1000000; n *= 10) {
+        initCubes(n);
+        display();
+        glFinish();
+
+        double update = 0.0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            display();
+            glFinish();
+            update += updateMs;
+        }
+        double frame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() /
+                       frames;
+        printf("%8zu %12.3f %12.2f %12.2f\n", n, update / frames, frame, n / frame * 1e-3);
+    }
+}
+
+void initData()
+{
+    if (sphereSlices > 0) {
+        std::vector<MeshVertex> sphere = sphereTriangles(sphereSlices, sphereSlices / 2);
+        mesh.upload(sphere.data(), sphere.size(), compactMesh);
+        printf("sphere: %zu triangle vertices -> ", sphere.size());
+    } else {
+        mesh.upload(cube, sizeof(cube) / sizeof(cube[0]), compactMesh);
+        printf("cube: 36 triangle vertices -> ");
+    }
+    printf("%zu vertices of %zu bytes, %zu vertex + %zu index bytes\n", mesh.vertexCount(),
+           mesh.vertexFormat().stride, mesh.vertexBytes(), mesh.indexBytes());
+
+    if (cookedPath) {
+        for (int i = 0; i < textureCount; i++) {
+            unsigned int t = loadCookedTexture(cookedPath);
+            if (i == 0) texture = t;
+        }
+    } else if (textureLoader) {
+        // Drawn with a placeholder until the first one is resident.
+        for (int i = 0; i < textureCount; i++)
+            textureLoader->load("container.jpg");
+    } else {
+        for (int i = 0; i < textureCount; i++) {
+            unsigned int t = loadTextureSync("container.jpg");
+            if (i == 0) texture = t;
+        }
+    }
+
     glEnable(GL_DEPTH_TEST);
 }
 
 void initShaders()
 {
     program = createShaderProgram(vertex_code, fragment_code);
+    uniforms.init(program, {"model", "view", "projection"});
+    instanceProgram = createShaderProgram(instance_vertex_code, fragment_code);
+    instanceUniforms.init(instanceProgram, {"model", "view", "projection"});
+    atlasProgram = createShaderProgram(atlas_vertex_code, atlas_fragment_code);
+    atlasUniforms.init(atlasProgram, {"model", "view", "projection"});
+
+    glm::mat4 Rx = glm::rotate(glm::mat4(1.0f), glm::radians(10.0f), glm::vec3(1.0f,0.0f,0.0f));
+    glm::mat4 Ry = glm::rotate(glm::mat4(1.0f), glm::radians(-30.0f), glm::vec3(0.0f,1.0f,0.0f));
+    model = Rx * Ry;
+    view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f,0.0f,-5.0f));
+    projection = glm::perspective(glm::radians(45.0f), (float)win_width/win_height, 0.1f, 100.0f);
 }
 
 int main(int argc, char** argv)
 {
+    startTime = std::chrono::steady_clock::now();
+
     glutInit(&argc, argv);
     glutInitContextVersion(3, 3);
     glutInitContextProfile(GLUT_CORE_PROFILE);
@@ -226,12 +625,71 @@ int main(int argc, char** argv)
 
     glewInit();
 
+    // Opções: --expanded, --sphere N, --stats [arquivo.csv], --textures N, --decoders N, --sync,
+    // --cooked arquivo.tex, --sprites N, --atlas, --cubes N, --cube-bench [quadros]
+    bool syncTextures = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--expanded") == 0) {
+            compactMesh = false;
+        } else if (strcmp(argv[i], "--sphere") == 0 && i + 1 < argc) {
+            sphereSlices = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            frameStats = new FrameStats();
+            if (i + 1 < argc && argv[i + 1][0] != '-') statsPath = argv[++i];
+        } else if (strcmp(argv[i], "--textures") == 0 && i + 1 < argc) {
+            textureCount = std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--decoders") == 0 && i + 1 < argc) {
+            decoderThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sync") == 0) {
+            syncTextures = true;
+        } else if (strcmp(argv[i], "--cooked") == 0 && i + 1 < argc) {
+            cookedPath = argv[++i];
+        } else if (strcmp(argv[i], "--sprites") == 0 && i + 1 < argc) {
+            spriteCount = std::max(atoi(argv[++i]), 0);
+        } else if (strcmp(argv[i], "--atlas") == 0) {
+            useAtlas = true;
+        } else if (strcmp(argv[i], "--cubes") == 0 && i + 1 < argc) {
+            cubeCount = std::min(std::max(atol(argv[++i]), 0L), 1000000L);
+        } else if (strcmp(argv[i], "--cube-bench") == 0) {
+            cubeBenchFrames = 20;
+            if (i + 1 < argc && argv[i + 1][0] != '-') cubeBenchFrames = std::max(atoi(argv[++i]), 1);
+        }
+    }
+    if (!syncTextures && !cookedPath)
+        textureLoader = new TextureLoader(decoderThreads);
+
     initData();
     initShaders();
+    if (spriteCount > 0)
+        initSprites();
+    if (cubeCount > 0 || cubeBenchFrames > 0) {
+        updatePool = new ThreadPool();
+        initCubes(cubeCount);
+    }
+    if (cubeBenchFrames > 0) {
+        runCubeBench(cubeBenchFrames);
+        delete updatePool;
+        delete textureLoader;
+        return 0;
+    }
 
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
 
+    if (frameStats || cubeCount > 0) {
+        // Redraw continuously (timing, animated cubes) and return from the main loop to dump the CSV.
+        glutIdleFunc(glutPostRedisplay);
+        glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+    }
+
     glutMainLoop();
+
+    if (frameStats) {
+        frameStats->finish();
+        frameStats->writeCSV(statsPath);
+        delete frameStats;
+    }
+    delete updatePool;
+    delete textureLoader;
 }
@@ -0,0 +1,82 @@
+/**
+ * @file texture_cooker.cpp
+ * Offline texture cooking: decodes an image once, builds its mip chain
+ * and writes it in the cooked format (see cooked_texture.h).
+ *
+ * Usage: texture_cooker [-j threads] [-l] input output
+ *
+ *   -j  Threads for the mip chain (default: all cores).
+ *   -l  Average colors in linear light (the image is taken as sRGB).
+ *       Without it, levels match what glGenerateMipmap usually builds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "cooked_texture.h"
+#include "thread_pool.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: texture_cooker [-j threads] [-l] input output\n");
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    unsigned threads = 0;
+    bool linearLight = false;
+    const char* paths[2];
+    int npaths = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0)
+            linearLight = true;
+        else if (npaths < 2)
+            paths[npaths++] = argv[i];
+        else
+            usage();
+    }
+    if (npaths != 2) usage();
+
+    Clock::time_point t0 = Clock::now();
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(paths[0], &width, &height, &channels, 0);
+    if (!pixels) {
+        fprintf(stderr, "%s: %s\n", paths[0], stbi_failure_reason());
+        return 1;
+    }
+    double decodeMs = msSince(t0);
+
+    ThreadPool pool(threads);
+    MipChain chain;
+    t0 = Clock::now();
+    buildMipChain(pixels, width, height, channels, linearLight, &pool, chain);
+    double mipMs = msSince(t0);
+    stbi_image_free(pixels);
+
+    t0 = Clock::now();
+    if (!writeCookedTexture(paths[1], chain)) {
+        perror(paths[1]);
+        return 1;
+    }
+    double writeMs = msSince(t0);
+
+    printf("%s: %dx%d, %d channels, %zu levels, %zu bytes; decode %.2f ms, mips %.2f ms (%u threads), write %.2f ms\n",
+           paths[1], width, height, channels, chain.levels.size(), chain.pixels.size(), decodeMs, mipMs,
+           pool.size(), writeMs);
+    return 0;
+}
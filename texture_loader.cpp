@@ -0,0 +1,203 @@
+/**
+ * @file texture_loader.cpp
+ * Textures loaded in the background, shown as a placeholder until ready.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <GL/glew.h>
+#include "atlas.h"
+#include "cooked_texture.h"
+#include "texture_loader.h"
+
+TextureLoader::TextureLoader(unsigned decoderThreads, size_t frameBudget)
+    : decoder(decoderThreads), frameBudget(std::max(frameBudget, (size_t)1))
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+    for (Upload& u : uploads)
+        freeImage(u.image);
+}
+
+size_t TextureLoader::load(const char* path)
+{
+    if (placeholder == 0) {
+        const unsigned char grey[4] = {128, 128, 128, 255};
+        glGenTextures(1, &placeholder);
+        glBindTexture(GL_TEXTURE_2D, placeholder);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glGenBuffers(1, &PBO);
+    }
+
+    size_t id = names.size();
+    names.push_back(0);
+    failed.push_back(false);
+    decoder.push(id, path);
+    return id;
+}
+
+unsigned int TextureLoader::texture(size_t id) const
+{
+    return names[id] != 0 ? names[id] : placeholder;
+}
+
+static GLenum pixelFormat(int channels)
+{
+    switch (channels) {
+        case 1:  return GL_RED;
+        case 2:  return GL_RG;
+        case 3:  return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+unsigned int loadCookedTexture(const char* path)
+{
+    CookedTexture cooked;
+    if (!cooked.open(path)) return 0;
+    const CookedHeader& h = cooked.header();
+    GLenum format = pixelFormat(h.channels);
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, h.levels - 1);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < h.levels; i++) {
+        const CookedLevel& l = cooked.level(i);
+        glTexImage2D(GL_TEXTURE_2D, i, format, l.width, l.height, 0, format, GL_UNSIGNED_BYTE,
+                     cooked.levelPixels(i));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+unsigned int uploadAtlas(const uint8_t* pixels, int size, int layers, int channels, int padding)
+{
+    int maxLevel = atlasMaxLevel(padding);
+    GLenum format = pixelFormat(channels);
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, maxLevel);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, size, size, layers, 0, format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return texture;
+}
+
+/** Allocates the texture of a decoded image and queues its rows. */
+void TextureLoader::begin(const DecodedImage& image)
+{
+    if (!image.pixels) {
+        fprintf(stderr, "Failed to load texture %zu\n", image.id);
+        failed[image.id] = true;
+        doneCount++;
+        return;
+    }
+
+    Upload u = {image, 0, 0};
+    GLenum format = pixelFormat(image.channels);
+    glGenTextures(1, &u.texture);
+    glBindTexture(GL_TEXTURE_2D, u.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, NULL);
+    uploads.push_back(u);
+}
+
+/**
+ * Uploads whole rows of the queued images, oldest first, until budget
+ * bytes are used; at least one row, so an image wider than the budget
+ * still makes progress.
+ *
+ * @return Bytes uploaded.
+ */
+size_t TextureLoader::uploadRows(size_t budget)
+{
+    size_t used = 0;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, PBO);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    while (!uploads.empty() && used < budget) {
+        Upload& u = uploads.front();
+        const DecodedImage& image = u.image;
+        size_t rowBytes = (size_t)image.width * image.channels;
+        int rows = (int)std::min((size_t)(image.height - u.row),
+                                 std::max((budget - used) / rowBytes, (size_t)1));
+        size_t bytes = rows * rowBytes;
+
+        // Orphaning gives fresh storage, so the copy never waits for the
+        // previous chunk to reach the texture.
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        memcpy(dst, image.pixels + u.row * rowBytes, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        glBindTexture(GL_TEXTURE_2D, u.texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, u.row, image.width, rows, pixelFormat(image.channels),
+                        GL_UNSIGNED_BYTE, (void*)0);
+        u.row += rows;
+        used += bytes;
+
+        if (u.row == image.height) {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            names[image.id] = u.texture;
+            doneCount++;
+            freeImage(u.image);
+            uploads.pop_front();
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return used;
+}
+
+void TextureLoader::update()
+{
+    DecodedImage image;
+    while (decoder.poll(image))
+        begin(image);
+    if (!uploads.empty())
+        uploadRows(frameBudget);
+}
+
+void TextureLoader::finish()
+{
+    DecodedImage image;
+    while (pending() > 0) {
+        while (decoder.poll(image))
+            begin(image);
+        if (!uploads.empty())
+            uploadRows(SIZE_MAX);
+        else if (decoder.wait(image))
+            begin(image);
+        else
+            break;
+    }
+}
@@ -0,0 +1,103 @@
+/**
+ * @file texture_loader.h
+ * Textures loaded in the background, shown as a placeholder until ready.
+ */
+
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "image_decoder.h"
+
+/**
+ * Uploads a cooked texture (see cooked_texture.h) level by level from its
+ * memory-mapped file: no decoding and no glGenerateMipmap. Same wrapping
+ * and filtering as TextureLoader.
+ *
+ * @return The texture, or 0 if the file is not a valid cooked texture.
+ */
+unsigned int loadCookedTexture(const char* path);
+
+/**
+ * Uploads packed atlas layers (see atlas.h) as a GL_TEXTURE_2D_ARRAY.
+ *
+ * Mipmaps stop at atlasMaxLevel(padding), so filtering never mixes
+ * neighbouring images; the edges clamp.
+ *
+ * @param pixels layers consecutive size x size images.
+ * @param padding Gutter blitToAtlas left around each image.
+ */
+unsigned int uploadAtlas(const uint8_t* pixels, int size, int layers, int channels, int padding);
+
+/**
+ * Loads image files into mipmapped GL_TEXTURE_2D textures without
+ * blocking the frame.
+ *
+ * Files are decoded by an ImageDecoder. update(), called once per frame
+ * on the GL thread, uploads decoded rows through a pixel unpack buffer,
+ * at most a fixed number of bytes per call, so a large image is spread
+ * over several frames instead of stalling one. Until a texture is
+ * complete, texture() returns a 1x1 grey placeholder; draws can bind it
+ * every frame and pick up the real one as soon as it is resident.
+ * Textures use repeat wrapping and trilinear filtering. All calls but the
+ * constructor and destructor need a current context; the destructor only
+ * stops the decoder and frees pixels, the GL objects go with the context.
+ */
+class TextureLoader
+{
+public:
+    /**
+     * @param decoderThreads Decoding threads; 0 uses all cores.
+     * @param frameBudget Most pixel bytes update() uploads per call.
+     */
+    explicit TextureLoader(unsigned decoderThreads = 0, size_t frameBudget = 1 << 20);
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    /** Queues a file; returns the id to pass to texture(). */
+    size_t load(const char* path);
+
+    /** Texture to bind for id: the placeholder until the image is resident. */
+    unsigned int texture(size_t id) const;
+
+    /** True once the image of id is uploaded, or failed to load. */
+    bool done(size_t id) const { return names[id] != 0 || failed[id]; }
+
+    /** Textures not done yet. */
+    size_t pending() const { return names.size() - doneCount; }
+
+    /** Uploads up to the frame budget of decoded pixels. */
+    void update();
+
+    /** Decodes and uploads everything queued, blocking. */
+    void finish();
+
+private:
+    /** Image being uploaded: rows [0, row) are in texture already. */
+    struct Upload
+    {
+        DecodedImage image;
+        unsigned int texture;
+        int row;
+    };
+
+    void begin(const DecodedImage& image);
+    size_t uploadRows(size_t budget);
+
+    ImageDecoder decoder;
+    size_t frameBudget;
+
+    unsigned int placeholder = 0, PBO = 0;
+    /** Resident texture per id, 0 until done. */
+    std::vector<unsigned int> names;
+    std::vector<bool> failed;
+    size_t doneCount = 0;
+    std::deque<Upload> uploads;
+};
+
+#endif
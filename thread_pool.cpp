@@ -0,0 +1,140 @@
+/**
+ * @file thread_pool.cpp
+ * Fixed-size pool of worker threads for data-parallel loops.
+ */
+
+#include <algorithm>
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    ranges.reset(new Range[threads]);
+    for (unsigned i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : workers)
+        t.join();
+}
+
+static inline uint64_t packRange(uint64_t begin, uint64_t end)
+{
+    return begin << 32 | end;
+}
+
+/** Takes the next index of the thread's own range. */
+bool ThreadPool::popFront(unsigned self, size_t& index)
+{
+    std::atomic<uint64_t>& bounds = ranges[self].bounds;
+    uint64_t r = bounds.load();
+
+    for (;;) {
+        uint64_t begin = r >> 32, end = r & 0xFFFFFFFF;
+        if (begin >= end) return false;
+        if (bounds.compare_exchange_weak(r, packRange(begin + 1, end))) {
+            index = begin;
+            return true;
+        }
+    }
+}
+
+/**
+ * Moves the back half of the largest other range into the thread's own
+ * (empty) range. Only the owner writes an empty range, so a plain store
+ * is enough there.
+ *
+ * @return False once every range is empty.
+ */
+bool ThreadPool::steal(unsigned self)
+{
+    for (;;) {
+        unsigned victim = self;
+        uint64_t best = 0, r = 0;
+
+        for (unsigned t = 0; t < size(); t++) {
+            uint64_t v = ranges[t].bounds.load();
+            uint64_t left = (v & 0xFFFFFFFF) - std::min(v >> 32, v & 0xFFFFFFFF);
+            if (t != self && left > best) {
+                best = left;
+                victim = t;
+                r = v;
+            }
+        }
+        if (victim == self) return false;
+
+        uint64_t begin = r >> 32, end = r & 0xFFFFFFFF;
+        uint64_t mid = begin + (end - begin) / 2;
+        if (ranges[victim].bounds.compare_exchange_strong(r, packRange(begin, mid))) {
+            ranges[self].bounds.store(packRange(mid, end));
+            return true;
+        }
+    }
+}
+
+void ThreadPool::runJob(unsigned self)
+{
+    size_t i;
+    do {
+        while (popFront(self, i))
+            (*job)(i);
+    } while (steal(self));
+}
+
+void ThreadPool::workerLoop(unsigned self)
+{
+    unsigned seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        runJob(self);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--active == 0)
+            done.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    if (count == 0) return;
+
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++)
+            body(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        for (unsigned t = 0; t < size(); t++)
+            ranges[t].bounds.store(packRange(count * t / size(), count * (t + 1) / size()));
+        active = (unsigned)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    runJob(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return active == 0; });
+    job = nullptr;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file thread_pool.h
+ * Fixed-size pool of worker threads for data-parallel loops.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    /**
+     * Creates the pool.
+     *
+     * @param threads Total number of threads, including the caller of
+     *        parallelFor. 0 uses std::thread::hardware_concurrency().
+     */
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** Number of threads working on a parallelFor, including the caller. */
+    unsigned size() const { return (unsigned)workers.size() + 1; }
+
+    /**
+     * Runs body(i) for every i in [0, count) and waits for completion.
+     *
+     * Each thread starts on its own contiguous range of indices, so nearby
+     * indices run on the same thread. A thread that runs out steals the
+     * back half of the largest remaining range, so uneven work balances
+     * itself. count must fit in 32 bits.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    /** Remaining indices [begin, end) of one thread, packed for CAS. */
+    struct alignas(64) Range
+    {
+        std::atomic<uint64_t> bounds{0};
+    };
+
+    void workerLoop(unsigned self);
+    void runJob(unsigned self);
+    bool popFront(unsigned self, size_t& index);
+    bool steal(unsigned self);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(size_t)>* job = nullptr;
+    std::unique_ptr<Range[]> ranges;
+    unsigned active = 0;
+    unsigned generation = 0;
+    bool stopping = false;
+};
+
+#endif
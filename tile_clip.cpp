@@ -0,0 +1,117 @@
+/**
+ * @file tile_clip.cpp
+ * Clipping a polygon set against a grid of rectangles (map tiles) in
+ * parallel.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "tile_clip.h"
+#include "thread_pool.h"
+
+/** Polygons per task when computing the bounding boxes. */
+static const size_t BOUNDS_CHUNK = 4096;
+
+/**
+ * Tiles [first, last] along one axis overlapped by [b0, b1].
+ *
+ * The estimate from the division is corrected against the same edges the
+ * clipper uses, so a box touching an edge is never left out by rounding.
+ *
+ * @param edge Boundary function, edge(0) .. edge(n).
+ * @return False if [b0, b1] misses the grid.
+ */
+template <typename Edge>
+static bool tileRange(float b0, float b1, int n, const Edge& edge, int& first, int& last)
+{
+    float lo = edge(0), hi = edge(n);
+    if (!(b1 >= lo && b0 <= hi)) return false;
+
+    float scale = n / (hi - lo);
+    first = std::min(std::max((int)std::floor((b0 - lo) * scale), 0), n - 1);
+    last  = std::min(std::max((int)std::floor((b1 - lo) * scale), 0), n - 1);
+
+    // first: smallest tile with edge(first + 1) >= b0.
+    while (first > 0 && edge(first) >= b0) first--;
+    while (first < n - 1 && edge(first + 1) < b0) first++;
+    // last: largest tile with edge(last) <= b1.
+    while (last < n - 1 && edge(last + 1) <= b1) last++;
+    while (last > 0 && edge(last) > b1) last--;
+
+    return first <= last;
+}
+
+bool tileSpan(const TileGrid& grid, glm::vec4 box, int& c0, int& c1, int& r0, int& r1)
+{
+    auto edgeX = [&](int c) { return grid.edgeX(c); };
+    auto edgeY = [&](int r) { return grid.edgeY(r); };
+    return tileRange(box.x, box.z, grid.cols, edgeX, c0, c1) && tileRange(box.y, box.w, grid.rows, edgeY, r0, r1);
+}
+
+void clipPolygonsToTiles(const PolygonSoA& polygons, const TileGrid& grid, TileClipResult& out, ThreadPool& pool)
+{
+    size_t count = polygons.size();
+    size_t tiles = grid.count();
+
+    // Bounding boxes.
+    out.bounds.resize(count);
+    pool.parallelFor((count + BOUNDS_CHUNK - 1) / BOUNDS_CHUNK, [&](size_t chunk) {
+        size_t end = std::min(count, (chunk + 1) * BOUNDS_CHUNK);
+        for (size_t p = chunk * BOUNDS_CHUNK; p < end; p++) {
+            glm::vec4 b(INFINITY, INFINITY, -INFINITY, -INFINITY);
+            for (uint32_t i = polygons.offsets[p]; i < polygons.offsets[p + 1]; i++) {
+                b.x = std::min(b.x, polygons.x[i]);
+                b.y = std::min(b.y, polygons.y[i]);
+                b.z = std::max(b.z, polygons.x[i]);
+                b.w = std::max(b.w, polygons.y[i]);
+            }
+            out.bounds[p] = b;
+        }
+    });
+
+    // Bin polygons by tile: count, prefix sum, fill.
+    auto forEachTile = [&](size_t p, auto&& f) {
+        int c0, c1, r0, r1;
+        if (!tileSpan(grid, out.bounds[p], c0, c1, r0, r1)) return;
+        for (int r = r0; r <= r1; r++)
+            for (int c = c0; c <= c1; c++)
+                f((size_t)r * grid.cols + c);
+    };
+
+    out.binOffsets.assign(tiles + 1, 0);
+    for (size_t p = 0; p < count; p++)
+        forEachTile(p, [&](size_t t) { out.binOffsets[t + 1]++; });
+    for (size_t t = 0; t < tiles; t++)
+        out.binOffsets[t + 1] += out.binOffsets[t];
+
+    out.binPolygons.resize(out.binOffsets[tiles]);
+    std::vector<uint32_t> fill(out.binOffsets.begin(), out.binOffsets.end() - 1);
+    for (size_t p = 0; p < count; p++)
+        forEachTile(p, [&](size_t t) { out.binPolygons[fill[t]++] = (uint32_t)p; });
+
+    // Clip each tile against its candidates.
+    out.tiles.resize(tiles);
+    out.sources.resize(tiles);
+    pool.parallelFor(tiles, [&](size_t t) {
+        static thread_local ClipBatchScratch scratch;
+        int c = (int)(t % grid.cols), r = (int)(t / grid.cols);
+        glm::vec2 tMin(grid.edgeX(c), grid.edgeY(r));
+        glm::vec2 tMax(grid.edgeX(c + 1), grid.edgeY(r + 1));
+        PolygonSoA& pieces = out.tiles[t];
+        std::vector<uint32_t>& sources = out.sources[t];
+
+        pieces.clear();
+        sources.clear();
+        for (uint32_t k = out.binOffsets[t]; k < out.binOffsets[t + 1]; k++) {
+            uint32_t p = out.binPolygons[k];
+            uint32_t first = polygons.offsets[p];
+            size_t n = clipPolygonSoA(polygons.x.data() + first, polygons.y.data() + first,
+                                      polygons.offsets[p + 1] - first, tMin, tMax, pieces, scratch);
+            if (n == 0) {
+                pieces.offsets.pop_back();
+                continue;
+            }
+            sources.push_back(p);
+        }
+    });
+}
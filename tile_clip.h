@@ -0,0 +1,77 @@
+/**
+ * @file tile_clip.h
+ * Clipping a polygon set against a grid of rectangles (map tiles) in
+ * parallel.
+ */
+
+#ifndef TILE_CLIP_H
+#define TILE_CLIP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "clip.h"
+
+class ThreadPool;
+
+/** cols x rows equal tiles covering the rectangle [pMin, pMax]. */
+struct TileGrid
+{
+    glm::vec2 pMin, pMax;
+    int cols, rows;
+
+    /** Number of tiles. */
+    size_t count() const { return (size_t)cols * rows; }
+
+    /** x of the boundary left of column c (c == cols is pMax.x). */
+    float edgeX(int c) const { return c == cols ? pMax.x : pMin.x + (pMax.x - pMin.x) * c / cols; }
+
+    /** y of the boundary below row r (r == rows is pMax.y). */
+    float edgeY(int r) const { return r == rows ? pMax.y : pMin.y + (pMax.y - pMin.y) * r / rows; }
+};
+
+/**
+ * Tiles touched by a bounding box: columns [c0, c1], rows [r0, r1].
+ *
+ * Uses the same edges the clipper does, so a box touching an edge is never
+ * left out by rounding.
+ *
+ * @param box Bounding box as (min x, min y, max x, max y).
+ * @return False if the box misses the grid.
+ */
+bool tileSpan(const TileGrid& grid, glm::vec4 box, int& c0, int& c1, int& r0, int& r1);
+
+/**
+ * Output of clipPolygonsToTiles. Tile (col, row) has index row * cols + col.
+ *
+ * Reuse the same object between calls: the vectors keep their capacity.
+ */
+struct TileClipResult
+{
+    /** Clipped pieces of each tile; empty pieces are dropped. */
+    std::vector<PolygonSoA> tiles;
+    /** Input polygon of each piece, parallel to tiles[t]. */
+    std::vector<std::vector<uint32_t>> sources;
+
+    /** Bounding box of each input polygon as (min x, min y, max x, max y). */
+    std::vector<glm::vec4> bounds;
+    /** Polygons whose box touches tile t: binPolygons[binOffsets[t], binOffsets[t + 1]). */
+    std::vector<uint32_t> binOffsets, binPolygons;
+};
+
+/**
+ * Clips every polygon against every tile of a grid.
+ *
+ * Polygons are first binned by bounding box, so each one is only clipped
+ * against the tiles its box touches. Tiles are then clipped in parallel
+ * with clipPolygonSoA, one per-thread scratch each.
+ *
+ * @param polygons Input polygons.
+ * @param grid Tile grid.
+ * @param out Result, overwritten.
+ * @param pool Thread pool running the tiles.
+ */
+void clipPolygonsToTiles(const PolygonSoA& polygons, const TileGrid& grid, TileClipResult& out, ThreadPool& pool);
+
+#endif
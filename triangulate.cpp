@@ -0,0 +1,392 @@
+/**
+ * @file triangulate.cpp
+ * Triangulation of simple polygons into indexed triangles.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include "triangulate.h"
+
+/** Polygons below this size are ear clipped by triangulate(). */
+static const size_t MONOTONE_MIN_VERTICES = 64;
+
+static inline double orient(glm::dvec2 a, glm::dvec2 b, glm::dvec2 c)
+{
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+static double signedArea(const glm::vec2* polygon, size_t n)
+{
+    double area = 0.0;
+    for (size_t i = 0, j = n - 1; i < n; j = i++)
+        area += (double)polygon[j].x * polygon[i].y - (double)polygon[i].x * polygon[j].y;
+    return area * 0.5;
+}
+
+/** Appends triangle (a, b, c) counter-clockwise. */
+static inline void emitTriangle(const glm::vec2* polygon, uint32_t a, uint32_t b, uint32_t c, uint32_t base,
+                                std::vector<uint32_t>& indices)
+{
+    if (orient(glm::dvec2(polygon[a]), glm::dvec2(polygon[b]), glm::dvec2(polygon[c])) < 0.0)
+        std::swap(b, c);
+    indices.push_back(base + a);
+    indices.push_back(base + b);
+    indices.push_back(base + c);
+}
+
+void triangulateEarClip(const glm::vec2* polygon, size_t n, uint32_t base, std::vector<uint32_t>& indices)
+{
+    if (n < 3) return;
+
+    // Work on a counter-clockwise doubly linked ring of vertices.
+    bool ccw = signedArea(polygon, n) >= 0.0;
+    std::vector<uint32_t> next(n), prev(n);
+    for (size_t i = 0; i < n; i++) {
+        size_t fwd = (i + 1) % n, back = (i + n - 1) % n;
+        next[i] = (uint32_t)(ccw ? fwd : back);
+        prev[i] = (uint32_t)(ccw ? back : fwd);
+    }
+
+    auto p = [&](uint32_t i) { return glm::dvec2(polygon[i]); };
+    auto isEar = [&](uint32_t b) {
+        uint32_t a = prev[b], c = next[b];
+        if (orient(p(a), p(b), p(c)) <= 0.0) return false;
+        for (uint32_t v = next[c]; v != a; v = next[v]) {
+            // Only reflex vertices can lie inside a convex ear.
+            if (orient(p(prev[v]), p(v), p(next[v])) > 0.0) continue;
+            if (orient(p(a), p(b), p(v)) >= 0.0 && orient(p(b), p(c), p(v)) >= 0.0 &&
+                orient(p(c), p(a), p(v)) >= 0.0)
+                return false;
+        }
+        return true;
+    };
+
+    uint32_t v = 0;
+    size_t remaining = n, misses = 0;
+    while (remaining > 3) {
+        if (isEar(v)) {
+            emitTriangle(polygon, prev[v], v, next[v], base, indices);
+            next[prev[v]] = next[v];
+            prev[next[v]] = prev[v];
+            v = prev[v];
+            remaining--;
+            misses = 0;
+        } else if (++misses > remaining) {
+            break;
+        } else {
+            v = next[v];
+        }
+    }
+
+    // Last triangle, or a fan over what is left when no ear was found.
+    for (uint32_t w = next[v]; next[w] != v; w = next[w])
+        emitTriangle(polygon, v, w, next[w], base, indices);
+}
+
+/*
+ * Monotone decomposition (de Berg et al., Computational Geometry, ch. 3).
+ *
+ * Vertices are swept top to bottom; "above" is y descending, then x
+ * ascending, so no two vertices are at the same height. Edge i goes from
+ * vertex i to i + 1 of the counter-clockwise polygon; the sweep status
+ * holds the edges with the interior on their right, ordered by x on the
+ * sweep line.
+ */
+
+struct MonotoneSweep
+{
+    const glm::vec2* polygon;
+    size_t n;
+    /** Polygon vertex of counter-clockwise vertex i. */
+    std::vector<uint32_t> map;
+    double sweepY = 0.0;
+
+    glm::dvec2 p(uint32_t i) const { return glm::dvec2(polygon[map[i]]); }
+
+    bool above(uint32_t a, uint32_t b) const
+    {
+        glm::dvec2 pa = p(a), pb = p(b);
+        return pa.y > pb.y || (pa.y == pb.y && pa.x < pb.x);
+    }
+
+    uint32_t nextOf(uint32_t i) const { return (uint32_t)((i + 1) % n); }
+    uint32_t prevOf(uint32_t i) const { return (uint32_t)((i + n - 1) % n); }
+
+    /** x of edge e on the sweep line (its upper end for horizontal edges). */
+    double edgeX(uint32_t e) const
+    {
+        glm::dvec2 a = p(e), b = p(nextOf(e));
+        if (a.y == b.y) return std::min(a.x, b.x);
+        double t = (sweepY - a.y) / (b.y - a.y);
+        return a.x + (b.x - a.x) * std::min(std::max(t, 0.0), 1.0);
+    }
+
+    /** x change per unit of descent below the sweep line, to break ties. */
+    double edgeSlope(uint32_t e) const
+    {
+        glm::dvec2 a = p(e), b = p(nextOf(e));
+        if (a.y == b.y) return INFINITY;
+        return (b.x - a.x) / (a.y - b.y);
+    }
+};
+
+/** Orders status edges left to right; also compares an edge with an x. */
+struct EdgeOrder
+{
+    typedef void is_transparent;
+    const MonotoneSweep* sweep;
+
+    bool operator()(uint32_t a, uint32_t b) const
+    {
+        double xa = sweep->edgeX(a), xb = sweep->edgeX(b);
+        if (xa != xb) return xa < xb;
+        double sa = sweep->edgeSlope(a), sb = sweep->edgeSlope(b);
+        if (sa != sb) return sa < sb;
+        return a < b;
+    }
+    bool operator()(uint32_t a, double x) const { return sweep->edgeX(a) < x; }
+    bool operator()(double x, uint32_t b) const { return x < sweep->edgeX(b); }
+};
+
+/** Splits the polygon along diagonals into faces, returned as vertex lists. */
+static void splitFaces(const MonotoneSweep& sweep, const std::vector<std::pair<uint32_t, uint32_t>>& diagonals,
+                       std::vector<std::vector<uint32_t>>& faces)
+{
+    size_t n = sweep.n;
+
+    // Outgoing half-edges per vertex: the polygon edge plus both directions
+    // of each diagonal, sorted by angle.
+    std::vector<std::vector<std::pair<double, uint32_t>>> out(n);
+    auto angle = [&](uint32_t a, uint32_t b) {
+        glm::dvec2 d = sweep.p(b) - sweep.p(a);
+        return std::atan2(d.y, d.x);
+    };
+    for (uint32_t i = 0; i < n; i++)
+        out[i].push_back(std::make_pair(angle(i, sweep.nextOf(i)), sweep.nextOf(i)));
+    for (const auto& d : diagonals) {
+        out[d.first].push_back(std::make_pair(angle(d.first, d.second), d.second));
+        out[d.second].push_back(std::make_pair(angle(d.second, d.first), d.first));
+    }
+    for (auto& list : out)
+        std::sort(list.begin(), list.end());
+
+    // Walk each face with its interior on the left: from u -> v, leave v by
+    // the first outgoing edge clockwise from v -> u.
+    std::vector<std::vector<bool>> used(n);
+    for (uint32_t i = 0; i < n; i++)
+        used[i].assign(out[i].size(), false);
+
+    for (uint32_t start = 0; start < n; start++) {
+        for (size_t k = 0; k < out[start].size(); k++) {
+            if (used[start][k]) continue;
+
+            std::vector<uint32_t> face;
+            uint32_t u = start;
+            size_t edge = k;
+            while (!used[u][edge]) {
+                used[u][edge] = true;
+                face.push_back(u);
+                uint32_t v = out[u][edge].second;
+
+                double back = angle(v, u);
+                const auto& list = out[v];
+                size_t j = list.size();
+                for (size_t q = list.size(); q-- > 0;) {
+                    if (list[q].first < back) {
+                        j = q;
+                        break;
+                    }
+                }
+                if (j == list.size()) j = list.size() - 1;
+
+                u = v;
+                edge = j;
+            }
+            faces.push_back(face);
+        }
+    }
+}
+
+/** Stack triangulation of one y-monotone counter-clockwise face. */
+static void triangulateMonotoneFace(const MonotoneSweep& sweep, const std::vector<uint32_t>& face, uint32_t base,
+                                    std::vector<uint32_t>& indices)
+{
+    size_t m = face.size();
+    if (m < 3) return;
+
+    size_t top = 0, bottom = 0;
+    for (size_t i = 1; i < m; i++) {
+        if (sweep.above(face[i], face[top])) top = i;
+        if (sweep.above(face[bottom], face[i])) bottom = i;
+    }
+
+    // Counter-clockwise from the top runs down the left chain; merge both
+    // chains into one top to bottom order.
+    std::vector<std::pair<uint32_t, bool>> order;  // vertex, on left chain
+    order.reserve(m);
+    size_t l = top, r = top;
+    order.push_back(std::make_pair(face[top], true));
+    while (order.size() < m) {
+        size_t nl = (l + 1) % m, nr = (r + m - 1) % m;
+        bool takeLeft = l != bottom && (r == bottom || sweep.above(face[nl], face[nr]));
+        if (takeLeft) {
+            l = nl;
+            order.push_back(std::make_pair(face[l], l != bottom));
+        } else {
+            r = nr;
+            order.push_back(std::make_pair(face[r], false));
+        }
+    }
+
+    auto emit = [&](uint32_t a, uint32_t b, uint32_t c) {
+        emitTriangle(sweep.polygon, sweep.map[a], sweep.map[b], sweep.map[c], base, indices);
+    };
+
+    std::vector<std::pair<uint32_t, bool>> stack;
+    stack.push_back(order[0]);
+    stack.push_back(order[1]);
+
+    for (size_t j = 2; j + 1 < m; j++) {
+        std::pair<uint32_t, bool> u = order[j];
+        if (u.second != stack.back().second) {
+            for (size_t s = 0; s + 1 < stack.size(); s++)
+                emit(u.first, stack[s].first, stack[s + 1].first);
+            std::pair<uint32_t, bool> last = stack.back();
+            stack.clear();
+            stack.push_back(last);
+            stack.push_back(u);
+        } else {
+            std::pair<uint32_t, bool> last = stack.back();
+            stack.pop_back();
+            while (!stack.empty()) {
+                double turn = orient(sweep.p(u.first), sweep.p(last.first), sweep.p(stack.back().first));
+                // The diagonal is inside when the chain turns away from it.
+                bool inside = u.second ? turn < 0.0 : turn > 0.0;
+                if (!inside) break;
+                emit(u.first, last.first, stack.back().first);
+                last = stack.back();
+                stack.pop_back();
+            }
+            stack.push_back(last);
+            stack.push_back(u);
+        }
+    }
+
+    uint32_t lowest = order[m - 1].first;
+    for (size_t s = 0; s + 1 < stack.size(); s++)
+        emit(lowest, stack[s].first, stack[s + 1].first);
+}
+
+bool triangulateMonotone(const glm::vec2* polygon, size_t n, uint32_t base, std::vector<uint32_t>& indices)
+{
+    if (n < 3) return true;
+
+    MonotoneSweep sweep;
+    sweep.polygon = polygon;
+    sweep.n = n;
+    sweep.map.resize(n);
+    bool ccw = signedArea(polygon, n) >= 0.0;
+    for (size_t i = 0; i < n; i++)
+        sweep.map[i] = (uint32_t)(ccw ? i : n - 1 - i);
+
+    std::vector<uint32_t> events(n);
+    for (size_t i = 0; i < n; i++) events[i] = (uint32_t)i;
+    std::sort(events.begin(), events.end(), [&](uint32_t a, uint32_t b) { return sweep.above(a, b); });
+
+    std::set<uint32_t, EdgeOrder> status(EdgeOrder{&sweep});
+    std::vector<uint32_t> helper(n);
+    std::vector<bool> merge(n, false);
+    std::vector<std::pair<uint32_t, uint32_t>> diagonals;
+
+    auto connectMerge = [&](uint32_t v, uint32_t e) {
+        if (merge[helper[e]]) diagonals.push_back(std::make_pair(v, helper[e]));
+    };
+    // Edge of the status left of v; none only if the polygon crosses itself.
+    auto leftOf = [&](uint32_t v, uint32_t& e) {
+        auto it = status.lower_bound(sweep.p(v).x);
+        if (it == status.begin()) return false;
+        e = *--it;
+        return true;
+    };
+
+    for (uint32_t v : events) {
+        uint32_t prev = sweep.prevOf(v), next = sweep.nextOf(v);
+        bool prevBelow = sweep.above(v, prev), nextBelow = sweep.above(v, next);
+        bool convex = orient(sweep.p(prev), sweep.p(v), sweep.p(next)) > 0.0;
+        sweep.sweepY = sweep.p(v).y;
+
+        if (prevBelow && nextBelow) {
+            if (convex) {
+                // Start vertex.
+                helper[v] = v;
+                status.insert(v);
+            } else {
+                // Split vertex: connect up to the helper of the edge on the left.
+                uint32_t e;
+                if (!leftOf(v, e)) return false;
+                diagonals.push_back(std::make_pair(v, helper[e]));
+                helper[e] = v;
+                helper[v] = v;
+                status.insert(v);
+            }
+        } else if (!prevBelow && !nextBelow) {
+            connectMerge(v, prev);
+            status.erase(prev);
+            if (!convex) {
+                // Merge vertex: wait for a vertex below to connect to.
+                merge[v] = true;
+                uint32_t e;
+                if (!leftOf(v, e)) return false;
+                connectMerge(v, e);
+                helper[e] = v;
+            }
+        } else if (!prevBelow) {
+            // Regular vertex on the left chain: the interior is on the right.
+            connectMerge(v, prev);
+            status.erase(prev);
+            helper[v] = v;
+            status.insert(v);
+        } else {
+            uint32_t e;
+            if (!leftOf(v, e)) return false;
+            connectMerge(v, e);
+            helper[e] = v;
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> faces;
+    splitFaces(sweep, diagonals, faces);
+    size_t first = indices.size();
+    for (const std::vector<uint32_t>& face : faces)
+        triangulateMonotoneFace(sweep, face, base, indices);
+
+    // A simple polygon always gives n - 2 triangles; anything else means
+    // the sweep was fooled by crossing edges.
+    if (indices.size() - first != 3 * (n - 2)) {
+        indices.resize(first);
+        return false;
+    }
+    return true;
+}
+
+void triangulate(const glm::vec2* polygon, size_t n, uint32_t base, std::vector<uint32_t>& indices)
+{
+    if (n < MONOTONE_MIN_VERTICES)
+        triangulateEarClip(polygon, n, base, indices);
+    else if (!triangulateMonotone(polygon, n, base, indices))
+        triangulateEarClip(polygon, n, base, indices);
+}
+
+const std::vector<uint32_t>& TriangulationCache::get(const glm::vec2* polygon, size_t n)
+{
+    dirty = !valid || points.size() != n || memcmp(points.data(), polygon, n * sizeof(glm::vec2)) != 0;
+    if (dirty) {
+        points.assign(polygon, polygon + n);
+        indices.clear();
+        triangulate(polygon, n, 0, indices);
+        valid = true;
+    }
+    return indices;
+}
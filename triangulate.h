@@ -0,0 +1,78 @@
+/**
+ * @file triangulate.h
+ * Triangulation of simple polygons into indexed triangles.
+ */
+
+#ifndef TRIANGULATE_H
+#define TRIANGULATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * Ear clipping, O(n^2).
+ *
+ * Appends n - 2 counter-clockwise triangles (3 indices each, offset by
+ * base) to indices. If no ear is found, which only happens for
+ * self-intersecting input, the rest is closed with a fan.
+ *
+ * @param polygon Vertices of a simple polygon, in either orientation.
+ * @param n Number of vertices.
+ * @param base Added to every index written.
+ * @param indices Receives the triangles.
+ */
+void triangulateEarClip(const glm::vec2* polygon, size_t n, uint32_t base, std::vector<uint32_t>& indices);
+
+/**
+ * Monotone decomposition then linear triangulation of each piece,
+ * O(n log n).
+ *
+ * A sweep line splits the polygon into y-monotone pieces with diagonals
+ * at split and merge vertices; each piece is then triangulated with a
+ * stack walk down its two chains. Same output format as
+ * triangulateEarClip.
+ *
+ * @return False, with nothing appended, if the sweep finds the polygon
+ *         is not simple (an edge crossing it leaves a vertex with no edge
+ *         to its left, or the pieces do not add up to n - 2 triangles).
+ *         Some self-intersecting polygons still pass and get triangles
+ *         that overlap; none make it read out of bounds.
+ */
+bool triangulateMonotone(const glm::vec2* polygon, size_t n, uint32_t base, std::vector<uint32_t>& indices);
+
+/**
+ * Ear clipping for small polygons, monotone decomposition above that.
+ *
+ * Non-simple input never fails: where triangulateMonotone gives up, ear
+ * clipping runs instead and closes what it cannot clip with a fan, so the
+ * triangles may overlap or leave parts of a self-intersecting polygon
+ * uncovered.
+ */
+void triangulate(const glm::vec2* polygon, size_t n, uint32_t base, std::vector<uint32_t>& indices);
+
+/**
+ * Triangulation kept until the polygon changes.
+ *
+ * get() compares the polygon with the one of the last call and only
+ * triangulates again when it differs, so a polygon redrawn every frame is
+ * triangulated once.
+ */
+class TriangulationCache
+{
+public:
+    /** Triangles of polygon, recomputed only if it changed. */
+    const std::vector<uint32_t>& get(const glm::vec2* polygon, size_t n);
+
+    /** True if the last get() had to triangulate. */
+    bool changed() const { return dirty; }
+
+private:
+    std::vector<glm::vec2> points;
+    std::vector<uint32_t> indices;
+    bool valid = false;
+    bool dirty = false;
+};
+
+#endif
@@ -0,0 +1,412 @@
+/**
+ * @file window_clip.cpp
+ * Polygon clipping against general clip windows: rotated rectangles,
+ * convex and concave polygons.
+ */
+
+#include <cmath>
+#include "window_clip.h"
+
+/** Largest convex window clipped with Sutherland-Hodgman instead of the grid. */
+static const size_t CONVEX_MAX_EDGES = 32;
+
+static inline double cross(glm::dvec2 a, glm::dvec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+double polygonArea2(const glm::vec2* polygon, size_t n)
+{
+    double area = 0.0;
+    for (size_t i = 0, j = n - 1; i < n; j = i++)
+        area += cross(glm::dvec2(polygon[j]), glm::dvec2(polygon[i]));
+    return area;
+}
+
+bool polygonIsConvex(const glm::vec2* polygon, size_t n)
+{
+    if (n < 3) return false;
+
+    // Turns of one sign are not enough: a star turns the same way at every
+    // vertex but winds twice, so the exterior angles must add up to one turn.
+    int sign = 0;
+    double turning = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        glm::dvec2 a(polygon[i]), b(polygon[(i + 1) % n]), c(polygon[(i + 2) % n]);
+        double turn = cross(b - a, c - b);
+        turning += std::atan2(turn, glm::dot(b - a, c - b));
+        if (turn == 0.0) continue;
+        int s = turn > 0.0 ? 1 : -1;
+        if (sign != 0 && s != sign) return false;
+        sign = s;
+    }
+    return sign != 0 && std::fabs(std::fabs(turning) - 2.0 * M_PI) < 1e-6;
+}
+
+std::vector<glm::vec2> rotatedRectangle(glm::vec2 pMin, glm::vec2 pMax, float angle)
+{
+    glm::vec2 center = (pMin + pMax) * 0.5f;
+    glm::vec2 half = (pMax - pMin) * 0.5f;
+    float c = std::cos(angle), s = std::sin(angle);
+
+    std::vector<glm::vec2> corners;
+    for (glm::vec2 d : {glm::vec2(-half.x, -half.y), glm::vec2(half.x, -half.y),
+                        glm::vec2(half.x, half.y), glm::vec2(-half.x, half.y)})
+        corners.push_back(center + glm::vec2(c * d.x - s * d.y, s * d.x + c * d.y));
+    return corners;
+}
+
+/** Removes repeated consecutive vertices, including last == first. */
+static void removeDuplicates(std::vector<glm::vec2>& points)
+{
+    size_t m = 0;
+    for (size_t i = 0; i < points.size(); i++)
+        if (m == 0 || points[i] != points[m - 1])
+            points[m++] = points[i];
+    while (m > 1 && points[m - 1] == points[0])
+        m--;
+    points.resize(m);
+}
+
+int ClipWindow::cellX(double x) const
+{
+    int c = (int)std::floor((x - boundsMin.x) / cellSize.x);
+    return std::min(std::max(c, 0), cols - 1);
+}
+
+int ClipWindow::cellY(double y) const
+{
+    int r = (int)std::floor((y - boundsMin.y) / cellSize.y);
+    return std::min(std::max(r, 0), rows - 1);
+}
+
+void ClipWindow::set(const std::vector<glm::vec2>& points)
+{
+    vertices = points;
+    removeDuplicates(vertices);
+    isConvex = polygonIsConvex(vertices.data(), vertices.size());
+
+    size_t m = vertices.size();
+    if (m == 0) {
+        cols = rows = 0;
+        return;
+    }
+
+    boundsMin = boundsMax = glm::dvec2(vertices[0]);
+    for (const glm::vec2& p : vertices) {
+        boundsMin = glm::min(boundsMin, glm::dvec2(p));
+        boundsMax = glm::max(boundsMax, glm::dvec2(p));
+    }
+
+    // About one edge per cell.
+    cols = rows = std::min(256, std::max(1, (int)std::ceil(std::sqrt((double)m))));
+    glm::dvec2 extent = boundsMax - boundsMin;
+    cellSize = glm::dvec2(extent.x > 0.0 ? extent.x / cols : 1.0, extent.y > 0.0 ? extent.y / rows : 1.0);
+
+    // Bucket the edges by the cells of their box, and by the rows they span.
+    auto forEachEdge = [&](auto&& f) {
+        for (size_t e = 0; e < m; e++) {
+            glm::dvec2 a(vertices[e]), b(vertices[(e + 1) % m]);
+            glm::dvec2 lo = glm::min(a, b), hi = glm::max(a, b);
+            f((uint32_t)e, cellX(lo.x), cellX(hi.x), cellY(lo.y), cellY(hi.y));
+        }
+    };
+
+    cellStart.assign((size_t)cols * rows + 1, 0);
+    rowStart.assign(rows + 1, 0);
+    forEachEdge([&](uint32_t, int c0, int c1, int r0, int r1) {
+        for (int r = r0; r <= r1; r++) {
+            rowStart[r + 1]++;
+            for (int c = c0; c <= c1; c++)
+                cellStart[(size_t)r * cols + c + 1]++;
+        }
+    });
+    for (size_t c = 0; c + 1 < cellStart.size(); c++)
+        cellStart[c + 1] += cellStart[c];
+    for (int r = 0; r < rows; r++)
+        rowStart[r + 1] += rowStart[r];
+
+    cellEdges.resize(cellStart.back());
+    rowEdges.resize(rowStart.back());
+    std::vector<uint32_t> cellFill(cellStart.begin(), cellStart.end() - 1);
+    std::vector<uint32_t> rowFill(rowStart.begin(), rowStart.end() - 1);
+    forEachEdge([&](uint32_t e, int c0, int c1, int r0, int r1) {
+        for (int r = r0; r <= r1; r++) {
+            rowEdges[rowFill[r]++] = e;
+            for (int c = c0; c <= c1; c++)
+                cellEdges[cellFill[(size_t)r * cols + c]++] = e;
+        }
+    });
+}
+
+/** Crossing-number update of the point in polygon test for edge (a, b). */
+static inline bool crossesRay(glm::dvec2 p, glm::dvec2 a, glm::dvec2 b)
+{
+    return (a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y);
+}
+
+bool ClipWindow::contains(glm::dvec2 p, bool accelerated) const
+{
+    size_t m = vertices.size();
+    if (m < 3) return false;
+    if (p.x < boundsMin.x || p.x > boundsMax.x || p.y < boundsMin.y || p.y > boundsMax.y)
+        return false;
+
+    bool inside = false;
+    if (accelerated) {
+        int r = cellY(p.y);
+        for (uint32_t k = rowStart[r]; k < rowStart[r + 1]; k++) {
+            uint32_t e = rowEdges[k];
+            if (crossesRay(p, glm::dvec2(vertices[e]), glm::dvec2(vertices[(e + 1) % m])))
+                inside = !inside;
+        }
+    } else {
+        for (size_t e = 0; e < m; e++)
+            if (crossesRay(p, glm::dvec2(vertices[e]), glm::dvec2(vertices[(e + 1) % m])))
+                inside = !inside;
+    }
+    return inside;
+}
+
+/** Point in polygon test against the subject, which has no grid. */
+static bool subjectContains(const std::vector<glm::dvec2>& polygon, glm::dvec2 p)
+{
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+        if (crossesRay(p, polygon[j], polygon[i]))
+            inside = !inside;
+    return inside;
+}
+
+enum SegmentHit { HIT_NONE, HIT_PROPER, HIT_DEGENERATE };
+
+/**
+ * Intersection of segments p0p1 and q0q1 at p0 + a (p1 - p0) = q0 + b (q1 - q0).
+ *
+ * Touching at an endpoint or overlapping is reported as degenerate, since
+ * the entry/exit labelling of the traversal needs proper crossings.
+ */
+static SegmentHit intersectSegments(glm::dvec2 p0, glm::dvec2 p1, glm::dvec2 q0, glm::dvec2 q1, double& a, double& b)
+{
+    const double eps = 1e-9;
+    glm::dvec2 r = p1 - p0, s = q1 - q0, qp = q0 - p0;
+    double d = cross(r, s);
+
+    if (d == 0.0) {
+        if (cross(qp, r) != 0.0) return HIT_NONE;
+        double rr = glm::dot(r, r);
+        double t0 = glm::dot(qp, r) / rr, t1 = t0 + glm::dot(s, r) / rr;
+        return std::max(t0, t1) < 0.0 || std::min(t0, t1) > 1.0 ? HIT_NONE : HIT_DEGENERATE;
+    }
+
+    a = cross(qp, s) / d;
+    b = cross(qp, r) / d;
+    if (a < -eps || a > 1.0 + eps || b < -eps || b > 1.0 + eps) return HIT_NONE;
+    if (a <= eps || a >= 1.0 - eps || b <= eps || b >= 1.0 - eps) return HIT_DEGENERATE;
+    return HIT_PROPER;
+}
+
+/** Proper crossing between subject edge edgeS and window edge edgeW. */
+struct Crossing
+{
+    uint32_t edgeS, edgeW;
+    double alphaS, alphaW;
+    glm::dvec2 p;
+};
+
+/**
+ * Crossings of one polygon in boundary order: order holds crossing
+ * indices sorted by edge, then alpha, and pos is the inverse.
+ */
+struct CrossingList
+{
+    std::vector<uint32_t> order, pos;
+    std::vector<bool> entry;
+};
+
+template <typename EdgeOf, typename AlphaOf>
+static void sortCrossings(const std::vector<Crossing>& crossings, EdgeOf edgeOf, AlphaOf alphaOf, CrossingList& list)
+{
+    size_t k = crossings.size();
+    list.order.resize(k);
+    list.pos.resize(k);
+    list.entry.resize(k);
+    for (size_t i = 0; i < k; i++) list.order[i] = (uint32_t)i;
+    std::sort(list.order.begin(), list.order.end(), [&](uint32_t a, uint32_t b) {
+        const Crossing &ca = crossings[a], &cb = crossings[b];
+        return edgeOf(ca) != edgeOf(cb) ? edgeOf(ca) < edgeOf(cb) : alphaOf(ca) < alphaOf(cb);
+    });
+    for (size_t i = 0; i < k; i++) list.pos[list.order[i]] = (uint32_t)i;
+}
+
+/** Labels each crossing as entry or exit, starting from whether vertex 0 is inside. */
+static void labelEntries(CrossingList& list, bool inside)
+{
+    for (uint32_t c : list.order) {
+        list.entry[c] = !inside;
+        inside = !inside;
+    }
+}
+
+/**
+ * Vertices passed when walking a polygon of n vertices from a crossing on
+ * edge e0 to the next one (forward) or previous one (backward) on edge e1.
+ * wrapped is set when the step goes past the end of the crossing order,
+ * i.e. through vertex 0.
+ */
+static inline size_t verticesBetween(uint32_t e0, uint32_t e1, size_t n, bool forward, bool wrapped)
+{
+    size_t d = forward ? (size_t)e1 - e0 : (size_t)e0 - e1;
+    return wrapped ? d + n : d;
+}
+
+/** Sutherland-Hodgman against the half-planes of a convex window. */
+static void clipConvex(const std::vector<glm::vec2>& subject, const std::vector<glm::vec2>& window,
+                       std::vector<glm::vec2>& out)
+{
+    double orientation = polygonArea2(window.data(), window.size()) > 0.0 ? 1.0 : -1.0;
+    std::vector<glm::dvec2> input(subject.begin(), subject.end()), output;
+
+    for (size_t e = 0; e < window.size() && !input.empty(); e++) {
+        glm::dvec2 a(window[e]), b(window[(e + 1) % window.size()]);
+        auto side = [&](glm::dvec2 p) { return orientation * cross(b - a, p - a); };
+
+        output.clear();
+        glm::dvec2 S = input.back();
+        double sS = side(S);
+        for (const glm::dvec2& E : input) {
+            double sE = side(E);
+            if (sS >= 0.0)
+                output.push_back(S);
+            if ((sS >= 0.0) != (sE >= 0.0))
+                output.push_back(S + (E - S) * (sS / (sS - sE)));
+            S = E;
+            sS = sE;
+        }
+        input.swap(output);
+    }
+
+    out.clear();
+    for (const glm::dvec2& p : input)
+        out.push_back(glm::vec2(p));
+}
+
+void clipToWindow(const std::vector<glm::vec2>& subject, const ClipWindow& window,
+                  std::vector<std::vector<glm::vec2>>& out, bool accelerated)
+{
+    out.clear();
+
+    std::vector<glm::vec2> polygon = subject;
+    removeDuplicates(polygon);
+    if (polygon.size() < 3 || window.size() < 3) return;
+
+    // Sutherland-Hodgman is O(n * m): only worth it for small windows.
+    if (window.convex() && window.size() <= CONVEX_MAX_EDGES && polygonIsConvex(polygon.data(), polygon.size())) {
+        std::vector<glm::vec2> piece;
+        clipConvex(polygon, window.points(), piece);
+        if (piece.size() >= 3) out.push_back(piece);
+        return;
+    }
+
+    static thread_local std::vector<uint32_t> stamp;
+    static thread_local uint32_t tick = 0;
+    if (stamp.size() < window.size()) stamp.assign(window.size(), 0);
+
+    const std::vector<glm::vec2>& w = window.points();
+    size_t n = polygon.size(), m = w.size();
+
+    glm::dvec2 lo(polygon[0]), hi(polygon[0]);
+    for (const glm::vec2& p : polygon) {
+        lo = glm::min(lo, glm::dvec2(p));
+        hi = glm::max(hi, glm::dvec2(p));
+    }
+    double scale = std::max(std::max(hi.x - lo.x, hi.y - lo.y), 1e-30);
+
+    // Find the crossings; on a degenerate contact, nudge the subject and retry.
+    std::vector<glm::dvec2> s(n);
+    std::vector<Crossing> crossings;
+    for (int attempt = 0; ; attempt++) {
+        glm::dvec2 offset(0.0);
+        if (attempt > 0)
+            offset = glm::dvec2(std::cos(2.4 * attempt), std::sin(2.4 * attempt)) * (scale * 1e-6 * attempt);
+        for (size_t i = 0; i < n; i++)
+            s[i] = glm::dvec2(polygon[i]) + offset;
+
+        crossings.clear();
+        bool degenerate = false;
+        for (size_t i = 0; i < n && !degenerate; i++) {
+            glm::dvec2 p0 = s[i], p1 = s[(i + 1) % n];
+            auto test = [&](uint32_t e) {
+                double a, b;
+                glm::dvec2 q0(w[e]), q1(w[(e + 1) % m]);
+                SegmentHit hit = intersectSegments(p0, p1, q0, q1, a, b);
+                if (hit == HIT_DEGENERATE) degenerate = true;
+                if (hit == HIT_PROPER) crossings.push_back(Crossing{(uint32_t)i, e, a, b, p0 + (p1 - p0) * a});
+            };
+            if (accelerated)
+                window.queryEdges(glm::min(p0, p1), glm::max(p0, p1), stamp, tick, test);
+            else
+                for (uint32_t e = 0; e < m; e++) test(e);
+        }
+        if (!degenerate || attempt == 16) break;
+    }
+
+    if (crossings.empty()) {
+        if (window.contains(s[0], accelerated))
+            out.push_back(polygon);
+        else if (subjectContains(s, glm::dvec2(w[0])))
+            out.push_back(w);
+        return;
+    }
+
+    // Both polygons only list their crossings; the vertices in between are
+    // walked by index, so a large window costs nothing per call.
+    CrossingList listS, listW;
+    sortCrossings(crossings, [](const Crossing& c) { return c.edgeS; }, [](const Crossing& c) { return c.alphaS; }, listS);
+    sortCrossings(crossings, [](const Crossing& c) { return c.edgeW; }, [](const Crossing& c) { return c.alphaW; }, listW);
+    labelEntries(listS, window.contains(s[0], accelerated));
+    labelEntries(listW, subjectContains(s, glm::dvec2(w[0])));
+
+    // Walk forward from entries and backward from exits, switching polygon
+    // at every crossing, until back at the start.
+    size_t k = crossings.size();
+    std::vector<bool> visited(k, false);
+
+    for (uint32_t start : listS.order) {
+        if (visited[start]) continue;
+
+        std::vector<glm::vec2> piece;
+        bool onSubject = true;
+        uint32_t c = start;
+        piece.push_back(glm::vec2(crossings[c].p));
+
+        while (!visited[c]) {
+            visited[c] = true;
+
+            const CrossingList& list = onSubject ? listS : listW;
+            size_t size = onSubject ? n : m;
+            bool forward = list.entry[c];
+            uint32_t i = list.pos[c];
+            bool wrapped = forward ? i + 1 == k : i == 0;
+            uint32_t next = list.order[forward ? (i + 1) % k : (i + k - 1) % k];
+
+            const Crossing &from = crossings[c], &to = crossings[next];
+            uint32_t e0 = onSubject ? from.edgeS : from.edgeW, e1 = onSubject ? to.edgeS : to.edgeW;
+
+            // Forward passes vertices e0 + 1 .. e1, backward e0 .. e1 + 1.
+            size_t count = verticesBetween(e0, e1, size, forward, wrapped);
+            for (size_t v = 0; v < count; v++) {
+                size_t idx = forward ? (e0 + 1 + v) % size : (e0 + size - v) % size;
+                piece.push_back(onSubject ? glm::vec2(s[idx]) : w[idx]);
+            }
+            piece.push_back(glm::vec2(to.p));
+
+            c = next;
+            onSubject = !onSubject;
+        }
+
+        // The walk ends on the starting crossing.
+        piece.pop_back();
+        if (piece.size() >= 3) out.push_back(piece);
+    }
+}
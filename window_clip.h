@@ -0,0 +1,119 @@
+/**
+ * @file window_clip.h
+ * Polygon clipping against general clip windows: rotated rectangles,
+ * convex and concave polygons.
+ */
+
+#ifndef WINDOW_CLIP_H
+#define WINDOW_CLIP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/** Twice the signed area of a polygon; positive when counter-clockwise. */
+double polygonArea2(const glm::vec2* polygon, size_t n);
+
+/**
+ * True if the polygon is convex, in either orientation: every turn has the
+ * same sign and the boundary winds once, which rules out stars.
+ */
+bool polygonIsConvex(const glm::vec2* polygon, size_t n);
+
+/** Corners of the rectangle [pMin, pMax] rotated by angle (radians) around its center. */
+std::vector<glm::vec2> rotatedRectangle(glm::vec2 pMin, glm::vec2 pMax, float angle);
+
+/**
+ * Clip window with its edges bucketed in a uniform grid.
+ *
+ * Build it once and clip many polygons against it: edge queries and
+ * point-in-polygon tests then only look at the edges of the cells they
+ * touch, instead of all m edges.
+ */
+class ClipWindow
+{
+public:
+    ClipWindow() {}
+    explicit ClipWindow(const std::vector<glm::vec2>& points) { set(points); }
+
+    /** Replaces the window polygon and rebuilds the grid. */
+    void set(const std::vector<glm::vec2>& points);
+
+    const std::vector<glm::vec2>& points() const { return vertices; }
+    size_t size() const { return vertices.size(); }
+    bool convex() const { return isConvex; }
+
+    /** Even-odd point in polygon test; accelerated uses the grid rows. */
+    bool contains(glm::dvec2 p, bool accelerated = true) const;
+
+    /**
+     * Calls f(edge) for every edge that may cross the box [lo, hi], each
+     * edge at most once. stamp must hold size() entries and be reused
+     * between calls (it is how duplicates are skipped).
+     */
+    template <typename F>
+    void queryEdges(glm::dvec2 lo, glm::dvec2 hi, std::vector<uint32_t>& stamp, uint32_t& tick, F f) const;
+
+private:
+    int cellX(double x) const;
+    int cellY(double y) const;
+
+    std::vector<glm::vec2> vertices;
+    bool isConvex = false;
+
+    glm::dvec2 boundsMin, boundsMax, cellSize;
+    int cols = 0, rows = 0;
+    /** Edges overlapping cell c: cellEdges[cellStart[c], cellStart[c + 1]). */
+    std::vector<uint32_t> cellStart, cellEdges;
+    /** Edges spanning row r in y: rowEdges[rowStart[r], rowStart[r + 1]). */
+    std::vector<uint32_t> rowStart, rowEdges;
+};
+
+/**
+ * Clips a polygon against a window, producing every piece of their
+ * intersection (Weiler-Atherton traversal, in the Greiner-Hormann form).
+ *
+ * Unlike Sutherland-Hodgman, concave windows and subjects give separate
+ * pieces instead of polygons joined by degenerate bridges. When a vertex
+ * lies exactly on the other polygon's boundary, the subject is moved by a
+ * tiny offset (about 1e-6 of its size) and the intersection recomputed.
+ * Convex subjects against small convex windows take a Sutherland-Hodgman
+ * path over the window edges, which gives the single piece directly.
+ *
+ * @param subject Polygon to clip.
+ * @param window Clip window.
+ * @param out Receives the pieces (cleared first).
+ * @param accelerated Use the window grid; false tests all n * m edge pairs.
+ */
+void clipToWindow(const std::vector<glm::vec2>& subject, const ClipWindow& window,
+                  std::vector<std::vector<glm::vec2>>& out, bool accelerated = true);
+
+template <typename F>
+void ClipWindow::queryEdges(glm::dvec2 lo, glm::dvec2 hi, std::vector<uint32_t>& stamp, uint32_t& tick, F f) const
+{
+    if (hi.x < boundsMin.x || lo.x > boundsMax.x || hi.y < boundsMin.y || lo.y > boundsMax.y)
+        return;
+
+    if (++tick == 0) {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        tick = 1;
+    }
+
+    int c0 = cellX(lo.x), c1 = cellX(hi.x);
+    int r0 = cellY(lo.y), r1 = cellY(hi.y);
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            size_t cell = (size_t)r * cols + c;
+            for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+                uint32_t e = cellEdges[k];
+                if (stamp[e] == tick) continue;
+                stamp[e] = tick;
+                f(e);
+            }
+        }
+    }
+}
+
+#endif